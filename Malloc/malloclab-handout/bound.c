@@ -0,0 +1,555 @@
+/*
+ * bound.c - Offline bounds on the heap size any non-moving allocator
+ *     needs for a trace.
+ *
+ * The lower bound is the peak of the live blocks, each padded to the
+ * header, alignment and minimum block size: at that moment every one
+ * of them has to be somewhere in the heap. For the other side we lay
+ * the blocks out knowing the whole trace, which an online allocator
+ * can't: each block is live from its malloc to its free, and is put at
+ * the lowest address that no block placed before it uses at any time
+ * during that lifetime. Which block goes first matters, so this is
+ * done in three orders (biggest first, longest lived first, and by
+ * malloc time) and the smallest heap is kept. A realloc ends one
+ * lifetime and starts another, the two overlapping for the copy. An
+ * order that takes too long on a big trace is given up.
+ * Online best fit with coalescing, an allocator anyone could write,
+ * is run too as a fallback, for the rare trace where it does better.
+ * The optimum lies between the lower bound and the best of these.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "bound.h"
+
+/* A free extent of the simulated heap */
+typedef struct {
+    size_t start;
+    size_t len;
+} extent_t;
+
+/* A live block */
+typedef struct {
+    size_t addr;
+    size_t len;             /* block bytes, 0 if not allocated */
+} block_t;
+
+/* State of one simulation */
+typedef struct {
+    const bound_params_t *params;
+    extent_t *free;         /* sorted by start, never adjacent */
+    int nfree, maxfree;
+    size_t top;             /* end of the heap */
+} sim_t;
+
+void bound_default_params(bound_params_t *params)
+{
+    params->header = BOUND_HEADER;
+    params->align = BOUND_ALIGN;
+    params->minblock = BOUND_MINBLOCK;
+}
+
+/* block_size - Bytes of the block that holds a payload of size bytes */
+static size_t block_size(const bound_params_t *p, size_t size)
+{
+    size_t n = (size + p->header + p->align - 1) / p->align * p->align;
+    return n < p->minblock ? p->minblock : n;
+}
+
+/* find - Index of the first free extent starting at or after addr */
+static int find(const sim_t *s, size_t addr)
+{
+    int lo = 0, hi = s->nfree;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (s->free[mid].start < addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void remove_extent(sim_t *s, int i)
+{
+    memmove(s->free + i, s->free + i + 1,
+            (s->nfree - i - 1) * sizeof(extent_t));
+    s->nfree--;
+}
+
+/*
+ * release - Return [addr, addr+len) to the free list, coalescing with
+ *     its neighbours. Returns -1 if out of memory.
+ */
+static int release(sim_t *s, size_t addr, size_t len)
+{
+    int i = find(s, addr);
+    int prev = i > 0 && s->free[i-1].start + s->free[i-1].len == addr;
+    int next = i < s->nfree && addr + len == s->free[i].start;
+
+    if (prev && next) {
+        s->free[i-1].len += len + s->free[i].len;
+        remove_extent(s, i);
+    } else if (prev) {
+        s->free[i-1].len += len;
+    } else if (next) {
+        s->free[i].start = addr;
+        s->free[i].len += len;
+    } else {
+        if (s->nfree == s->maxfree) {
+            int max = s->maxfree ? 2 * s->maxfree : 256;
+            extent_t *p = realloc(s->free, max * sizeof(extent_t));
+            if (p == NULL)
+                return -1;
+            s->free = p;
+            s->maxfree = max;
+        }
+        memmove(s->free + i + 1, s->free + i,
+                (s->nfree - i) * sizeof(extent_t));
+        s->free[i].start = addr;
+        s->free[i].len = len;
+        s->nfree++;
+    }
+    return 0;
+}
+
+/*
+ * take - Use the first *len bytes of free extent i for a block. A
+ *     remainder too small to be a block stays with it (*len grows).
+ */
+static size_t take(sim_t *s, int i, size_t *len)
+{
+    size_t addr = s->free[i].start;
+
+    if (s->free[i].len - *len < s->params->minblock) {
+        *len = s->free[i].len;
+        remove_extent(s, i);
+    } else {
+        s->free[i].start += *len;
+        s->free[i].len -= *len;
+    }
+    return addr;
+}
+
+/*
+ * place - Best fit for a block of *len bytes, extending the heap
+ *     (through a free extent at its end, if there is one) when nothing
+ *     fits. Returns the block's address.
+ */
+static size_t place(sim_t *s, size_t *len)
+{
+    int i, best = -1;
+    size_t addr;
+
+    for (i = 0; i < s->nfree; i++) {
+        if (s->free[i].len >= *len &&
+            (best < 0 || s->free[i].len < s->free[best].len)) {
+            best = i;
+            if (s->free[i].len == *len)
+                break;
+        }
+    }
+    if (best >= 0)
+        return take(s, best, len);
+
+    i = s->nfree - 1;
+    if (i >= 0 && s->free[i].start + s->free[i].len == s->top) {
+        addr = s->free[i].start;
+        remove_extent(s, i);
+    } else {
+        addr = s->top;
+    }
+    s->top = addr + *len;
+    return addr;
+}
+
+/*
+ * resize - Best-fit realloc: shrink in place, grow into a free extent
+ *     that follows the block or past the end of the heap, and only
+ *     move the block when neither works. Returns -1 if out of memory.
+ */
+static int resize(sim_t *s, block_t *b, size_t len)
+{
+    size_t end = b->addr + b->len;
+    int i;
+
+    if (len <= b->len) {
+        if (b->len - len >= s->params->minblock) {
+            if (release(s, b->addr + len, b->len - len) < 0)
+                return -1;
+            b->len = len;
+        }
+        return 0;
+    }
+
+    i = find(s, end);
+    if (i < s->nfree && s->free[i].start == end &&
+        b->len + s->free[i].len >= len) {
+        size_t more = len - b->len;
+        take(s, i, &more);
+        b->len += more;
+        return 0;
+    }
+    if (i < s->nfree && s->free[i].start == end &&
+        end + s->free[i].len == s->top) {
+        remove_extent(s, i);
+        end = s->top;
+    }
+    if (end == s->top) {
+        s->top = b->addr + len;
+        b->len = len;
+        return 0;
+    }
+
+    /* Move it: the old block is only freed once the copy is done */
+    {
+        size_t addr = place(s, &len);
+        if (release(s, b->addr, b->len) < 0)
+            return -1;
+        b->addr = addr;
+        b->len = len;
+    }
+    return 0;
+}
+
+/* A block's lifetime, ops [start, end) */
+typedef struct {
+    int start, end;
+    size_t len;
+    size_t addr;            /* where it was put */
+} life_t;
+
+/* The orders the lifetimes are placed in; see bound_trace */
+static int by_size(const void *a, const void *b)
+{
+    const life_t *x = *(life_t *const *)a, *y = *(life_t *const *)b;
+
+    if (x->len != y->len)
+        return x->len < y->len ? 1 : -1;
+    return (y->end - y->start) - (x->end - x->start);
+}
+
+static int by_lifetime(const void *a, const void *b)
+{
+    const life_t *x = *(life_t *const *)a, *y = *(life_t *const *)b;
+
+    if (x->end - x->start != y->end - y->start)
+        return (y->end - y->start) - (x->end - x->start);
+    return x->len < y->len ? 1 : x->len > y->len ? -1 : 0;
+}
+
+static int by_start(const void *a, const void *b)
+{
+    const life_t *x = *(life_t *const *)a, *y = *(life_t *const *)b;
+
+    return x->start - y->start;
+}
+
+/*
+ * The trace is cut into SLICES slices of time, and each keeps the
+ * lifetimes placed so far that overlap it, sorted by address, in runs
+ * of at most RUN so that one can be put in without moving all the
+ * rest. Placing a lifetime then only looks at the slices it spans.
+ */
+#define SLICES 64
+#define RUN 256
+#define BUDGET 400000000L   /* lifetimes looked at before giving up */
+
+typedef struct {
+    int n;
+    life_t v[RUN];
+} run_t;
+
+typedef struct {
+    run_t **runs;
+    int nruns, maxruns;
+} layout_t;
+
+/*
+ * lowest - The lowest address from addr up where len bytes are free in
+ *     lay all through [start, end). Adds the lifetimes looked at to
+ *     *work.
+ */
+static size_t lowest(const layout_t *lay, int start, int end, size_t len,
+                     size_t addr, long *work)
+{
+    int r, i;
+
+    for (r = 0; r < lay->nruns; r++) {
+        const run_t *run = lay->runs[r];
+        *work += run->n;
+        for (i = 0; i < run->n; i++) {
+            const life_t *p = &run->v[i];
+            if (p->start >= end || p->end <= start ||
+                p->addr + p->len <= addr)
+                continue;
+            if (p->addr >= addr + len)
+                return addr;
+            addr = p->addr + p->len;
+        }
+    }
+    return addr;
+}
+
+/* put - Add l, placed, to lay. Returns -1 if out of memory. */
+static int put(layout_t *lay, const life_t *l)
+{
+    run_t *run, *half;
+    int r, i;
+
+    /* the last run whose first lifetime isn't above l */
+    for (r = lay->nruns - 1; r > 0; r--)
+        if (lay->runs[r]->v[0].addr <= l->addr)
+            break;
+    if (lay->nruns == 0 || lay->runs[r]->n == RUN) {
+        if (lay->nruns == lay->maxruns) {
+            int max = lay->maxruns ? 2 * lay->maxruns : 16;
+            run_t **p = realloc(lay->runs, max * sizeof(run_t *));
+            if (p == NULL)
+                return -1;
+            lay->runs = p;
+            lay->maxruns = max;
+        }
+        if ((half = malloc(sizeof(run_t))) == NULL)
+            return -1;
+        if (lay->nruns == 0) {
+            half->n = 0;
+            lay->runs[lay->nruns++] = half;
+            r = 0;
+        } else {
+            /* split the full run */
+            run = lay->runs[r];
+            half->n = RUN / 2;
+            memcpy(half->v, run->v + RUN / 2, RUN / 2 * sizeof(life_t));
+            run->n = RUN / 2;
+            memmove(lay->runs + r + 2, lay->runs + r + 1,
+                    (lay->nruns - r - 1) * sizeof(run_t *));
+            lay->runs[r + 1] = half;
+            lay->nruns++;
+            if (half->v[0].addr <= l->addr)
+                r++;
+        }
+    }
+    run = lay->runs[r];
+    for (i = run->n; i > 0 && run->v[i-1].addr > l->addr; i--)
+        ;
+    memmove(run->v + i + 1, run->v + i, (run->n - i) * sizeof(life_t));
+    run->v[i] = *l;
+    run->n++;
+    return 0;
+}
+
+/*
+ * pack - Place the n lifetimes of a trace of nops requests in the
+ *     order cmp gives, each at the lowest address free for all of it.
+ *     Returns the heap that takes, or 0 if out of memory or over
+ *     BUDGET. order is scratch space for n pointers.
+ */
+static size_t pack(life_t *lives, int n, int nops,
+                   int (*cmp)(const void *, const void *), life_t **order)
+{
+    layout_t *slices;
+    size_t top = 0, addr, a;
+    int width = nops / SLICES + 1;
+    int i, s, first, last, stable;
+    long work = 0;
+    life_t *l;
+
+    if ((slices = calloc(SLICES, sizeof(layout_t))) == NULL)
+        return 0;
+    for (i = 0; i < n; i++)
+        order[i] = &lives[i];
+    qsort(order, n, sizeof(life_t *), cmp);
+
+    for (i = 0; i < n && work <= BUDGET; i++) {
+        l = order[i];
+        first = l->start / width;
+        last = (l->end - 1) / width;
+        /* go round the slices until none of them moves it up */
+        addr = 0;
+        stable = 0;
+        for (s = first; stable <= last - first; s = s == last ? first : s + 1) {
+            a = lowest(&slices[s], l->start, l->end, l->len, addr, &work);
+            stable = a == addr ? stable + 1 : 1;
+            addr = a;
+        }
+        l->addr = addr;
+        for (s = first; s <= last; s++)
+            if (put(&slices[s], l) < 0)
+                work = BUDGET + 1;
+        if (addr + l->len > top)
+            top = addr + l->len;
+    }
+    if (work > BUDGET)
+        top = 0;
+    for (s = 0; s < SLICES; s++) {
+        for (i = 0; i < slices[s].nruns; i++)
+            free(slices[s].runs[i]);
+        free(slices[s].runs);
+    }
+    free(slices);
+    return top;
+}
+
+/*
+ * lifetimes - The lifetimes of the blocks of the nops requests in ops,
+ *     into *livesp. Returns how many, or -1 if out of memory.
+ */
+static int lifetimes(const bound_op_t *ops, int nops, int nids,
+                     const bound_params_t *params, life_t **livesp)
+{
+    life_t *lives;
+    int *cur;               /* each id's live lifetime, or -1 */
+    int i, n = 0;
+
+    lives = malloc((nops > 0 ? nops : 1) * sizeof(life_t));
+    cur = malloc((nids > 0 ? nids : 1) * sizeof(int));
+    if (lives == NULL || cur == NULL) {
+        free(lives);
+        free(cur);
+        return -1;
+    }
+    for (i = 0; i < nids; i++)
+        cur[i] = -1;
+
+    for (i = 0; i < nops; i++) {
+        const bound_op_t *op = &ops[i];
+        int id = op->index;
+
+        if (id < 0 || id >= nids)
+            continue;
+        if (op->type != BOUND_ALLOC && cur[id] >= 0) {
+            /* the old block of a realloc lives on through the copy */
+            lives[cur[id]].end = op->type == BOUND_REALLOC && op->size ?
+                i + 1 : i;
+            cur[id] = -1;
+        }
+        if (op->type == BOUND_FREE ||
+            (op->type == BOUND_REALLOC && op->size == 0))
+            continue;
+        lives[n].start = i;
+        lives[n].end = nops;
+        lives[n].len = block_size(params, op->size);
+        cur[id] = n++;
+    }
+    free(cur);
+    *livesp = lives;
+    return n;
+}
+
+/*
+ * offline - The smallest heap of the offline placements of the blocks
+ *     of ops, or 0 if out of memory
+ */
+static size_t offline(const bound_op_t *ops, int nops, int nids,
+                      const bound_params_t *params)
+{
+    static int (*const orders[])(const void *, const void *) = {
+        by_size, by_lifetime, by_start
+    };
+    life_t *lives, **order;
+    size_t top, best = 0;
+    int n, i;
+
+    if ((n = lifetimes(ops, nops, nids, params, &lives)) < 0)
+        return 0;
+    if ((order = malloc((n > 0 ? n : 1) * sizeof(life_t *))) != NULL) {
+        for (i = 0; i < (int)(sizeof(orders) / sizeof(orders[0])); i++) {
+            top = pack(lives, n, nops, orders[i], order);
+            if (top && (best == 0 || top < best))
+                best = top;
+        }
+    }
+    free(order);
+    free(lives);
+    return best;
+}
+
+int bound_trace(const bound_op_t *ops, int nops, int nids,
+                const bound_params_t *params, bound_t *bound)
+{
+    sim_t s;
+    block_t *blocks;
+    block_t *b;
+    size_t *sizes;          /* payload bytes of each live block */
+    double payload = 0, live = 0;
+    size_t top;
+    int i, ret = 0;
+
+    memset(bound, 0, sizeof(*bound));
+    memset(&s, 0, sizeof(s));
+    s.params = params;
+    blocks = calloc(nids > 0 ? nids : 1, sizeof(block_t));
+    sizes = calloc(nids > 0 ? nids : 1, sizeof(size_t));
+    if (blocks == NULL || sizes == NULL) {
+        ret = -1;
+        goto out;
+    }
+
+    for (i = 0; i < nops; i++) {
+        const bound_op_t *op = &ops[i];
+        size_t len;
+
+        if (op->index < 0 || op->index >= nids)
+            continue;
+        b = &blocks[op->index];
+
+        switch (op->type) {
+        case BOUND_ALLOC:
+            len = block_size(params, op->size);
+            b->addr = place(&s, &len);
+            b->len = len;
+            payload += op->size;
+            live += block_size(params, op->size);
+            sizes[op->index] = op->size;
+            break;
+
+        case BOUND_REALLOC:
+            payload += (double)op->size - sizes[op->index];
+            live += (op->size ? (double)block_size(params, op->size) : 0) -
+                (sizes[op->index] ? block_size(params, sizes[op->index]) : 0);
+            sizes[op->index] = op->size;
+            if (op->size == 0) {        /* just a free */
+                if (b->len && release(&s, b->addr, b->len) < 0)
+                    ret = -1;
+                b->len = 0;
+            } else if (b->len == 0) {   /* just an alloc */
+                len = block_size(params, op->size);
+                b->addr = place(&s, &len);
+                b->len = len;
+            } else if (resize(&s, b, block_size(params, op->size)) < 0) {
+                ret = -1;
+            }
+            break;
+
+        case BOUND_FREE:
+            if (b->len && release(&s, b->addr, b->len) < 0)
+                ret = -1;
+            payload -= sizes[op->index];
+            if (sizes[op->index])
+                live -= block_size(params, sizes[op->index]);
+            sizes[op->index] = 0;
+            b->len = 0;
+            break;
+        }
+        if (ret < 0)
+            goto out;
+
+        if (payload > bound->payload)
+            bound->payload = payload;
+        if (live > bound->live)
+            bound->live = live;
+        if (s.top > bound->placed)
+            bound->placed = s.top;
+    }
+
+    /* the online best fit above is only a fallback */
+    if ((top = offline(ops, nops, nids, params)) && top < bound->placed)
+        bound->placed = top;
+
+out:
+    free(s.free);
+    free(blocks);
+    free(sizes);
+    return ret;
+}
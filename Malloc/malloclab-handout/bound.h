@@ -0,0 +1,49 @@
+/*
+ * bound.h - Offline bounds on the heap size any non-moving allocator
+ *     needs for a trace, and so on the utilization it can reach
+ */
+#ifndef __BOUND_H_
+#define __BOUND_H_
+
+#include <stddef.h>
+
+/* Block size rules of mm.c; the defaults for bound_params_t */
+#define BOUND_HEADER   4
+#define BOUND_ALIGN    8
+#define BOUND_MINBLOCK 16
+
+/* One request of a trace */
+typedef struct {
+    enum { BOUND_ALLOC, BOUND_FREE, BOUND_REALLOC } type;
+    int index;              /* block id; -1 for free(NULL) */
+    size_t size;            /* payload bytes for alloc/realloc */
+} bound_op_t;
+
+/* How the allocator turns a request into a block */
+typedef struct {
+    size_t header;          /* per-block overhead in bytes */
+    size_t align;           /* block size and address alignment */
+    size_t minblock;        /* smallest block */
+} bound_params_t;
+
+typedef struct {
+    double payload;         /* peak live payload bytes */
+    double live;            /* peak live bytes in blocks: no allocator can
+                               use a smaller heap */
+    double placed;          /* smallest peak heap of the layouts bound.c
+                               tries: one that can be reached */
+} bound_t;
+
+/*
+ * bound_trace - Compute the bounds for the nops requests in ops, whose
+ *     block ids are below nids. Returns -1 if out of memory.
+ *     The utilization bound is b->payload / b->live, and laying the
+ *     blocks out offline reaches b->payload / b->placed.
+ */
+int bound_trace(const bound_op_t *ops, int nops, int nids,
+                const bound_params_t *params, bound_t *b);
+
+/* bound_default_params - Fill in mm.c's block size rules */
+void bound_default_params(bound_params_t *params);
+
+#endif /* __BOUND_H_ */
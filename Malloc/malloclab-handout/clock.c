@@ -10,9 +10,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/times.h>
 #include "clock.h"
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+/* The source behind start_counter() and get_counter() */
+static int counter_source = COUNTER_RDTSC;
+
 
 /******************************************************* 
  * Machine dependent functions 
@@ -33,6 +41,8 @@
 static unsigned cyc_hi = 0;
 static unsigned cyc_lo = 0;
 
+#define HAVE_TSC 1
+
 
 /* Set *hi and *lo to the high and low order bits  of the cycle counter.  
    Implementation requires assembly code to use the rdtsc instruction. */
@@ -44,21 +54,37 @@ void access_counter(unsigned *hi, unsigned *lo)
         : "%edx", "%eax");
 }
 
+/* Same, using rdtscp, which waits for all earlier instructions to
+   execute before reading the counter. */
+static void access_counter_p(unsigned *hi, unsigned *lo)
+{
+    asm volatile("rdtscp; movl %%edx,%0; movl %%eax,%1"
+                 : "=r" (*hi), "=r" (*lo)
+                 : /* No input */
+                 : "%edx", "%eax", "%ecx");
+}
+
 /* Record the current value of the cycle counter. */
-void start_counter()
+static void start_tsc()
 {
-    access_counter(&cyc_hi, &cyc_lo);
+    if (counter_source == COUNTER_RDTSCP)
+        access_counter_p(&cyc_hi, &cyc_lo);
+    else
+        access_counter(&cyc_hi, &cyc_lo);
 }
 
 /* Return the number of cycles since the last call to start_counter. */
-double get_counter()
+static double get_tsc()
 {
     unsigned ncyc_hi, ncyc_lo;
     unsigned hi, lo, borrow;
     double result;
 
     /* Get cycle counter */
-    access_counter(&ncyc_hi, &ncyc_lo);
+    if (counter_source == COUNTER_RDTSCP)
+        access_counter_p(&ncyc_hi, &ncyc_lo);
+    else
+        access_counter(&ncyc_hi, &ncyc_lo);
 
     /* Do double precision subtraction */
     lo = ncyc_lo - cyc_lo;
@@ -72,6 +98,29 @@ double get_counter()
 }
 /* $end x86cyclecounter */
 
+/*
+ * tsc_invariant - Does the TSC tick at a constant rate regardless of
+ *     frequency scaling and sleep states (CPUID 0x80000007, EDX bit 8)?
+ */
+int tsc_invariant()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (edx >> 8) & 1;
+}
+
+/* Is the rdtscp instruction available (CPUID 0x80000001, EDX bit 27)? */
+static int have_rdtscp()
+{
+    unsigned eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx))
+        return 0;
+    return (edx >> 27) & 1;
+}
+
 #elif defined(__alpha)
 
 /****************************************************
@@ -109,15 +158,16 @@ static unsigned int counterRoutine[] =
 /* Cast the above instructions into a function. */
 static unsigned int (*counter)(void)= (void *)counterRoutine;
 
+#define HAVE_TSC 1
 
-void start_counter()
+static void start_tsc()
 {
     /* Get cycle counter */
     cyc_hi = 0;
     cyc_lo = counter();
 }
 
-double get_counter()
+static double get_tsc()
 {
     unsigned ncyc_hi, ncyc_lo;
     unsigned hi, lo, borrow;
@@ -134,6 +184,9 @@ double get_counter()
     return result;
 }
 
+int tsc_invariant() { return 0; }
+static int have_rdtscp() { return 0; }
+
 #else
 
 /****************************************************************
@@ -144,7 +197,9 @@ double get_counter()
  * haven't provided a Sparc version here.
  ***************************************************************/
 
-void start_counter()
+#define HAVE_TSC 0
+
+static void start_tsc()
 {
     printf("ERROR: You are trying to use a start_counter routine in clock.c\n");
     printf("that has not been implemented yet on this platform.\n");
@@ -152,13 +207,16 @@ void start_counter()
     exit(1);
 }
 
-double get_counter() 
+static double get_tsc()
 {
     printf("ERROR: You are trying to use a get_counter routine in clock.c\n");
     printf("that has not been implemented yet on this platform.\n");
     printf("Please choose another timing package in config.h.\n");
     exit(1);
 }
+
+int tsc_invariant() { return 0; }
+static int have_rdtscp() { return 0; }
 #endif
 
 
@@ -167,6 +225,63 @@ double get_counter()
 /*******************************
  * Machine-independent functions
  ******************************/
+
+/* Read CLOCK_MONOTONIC_RAW, which is immune to NTP slewing, in ns */
+static double mono_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double mono_start = 0;
+
+/* Record the current value of the selected counter. */
+void start_counter()
+{
+    if (counter_source == COUNTER_MONOTONIC)
+        mono_start = mono_ns();
+    else
+        start_tsc();
+}
+
+/* Return the number of ticks since the last call to start_counter. */
+double get_counter()
+{
+    if (counter_source == COUNTER_MONOTONIC)
+        return mono_ns() - mono_start;
+    return get_tsc();
+}
+
+/*
+ * set_counter_source - Select the source for start/get_counter.
+ *     Returns -1 (leaving the source alone) if the CPU doesn't have it.
+ */
+int set_counter_source(int source)
+{
+    switch (source) {
+    case COUNTER_RDTSC:
+        if (!HAVE_TSC)
+            return -1;
+        break;
+    case COUNTER_RDTSCP:
+        if (!HAVE_TSC || !have_rdtscp())
+            return -1;
+        break;
+    case COUNTER_MONOTONIC:
+        break;
+    default:
+        return -1;
+    }
+    counter_source = source;
+    return 0;
+}
+
+int get_counter_source()
+{
+    return counter_source;
+}
 double ovhd()
 {
     /* Do it twice to eliminate cache effects */
@@ -219,6 +334,48 @@ double mhz(int verbose)
     return mhz_full(verbose, 2);
 }
 
+#define CALIBRATE_RUNS 5
+#define CALIBRATE_NS   10000000 /* 10 ms per run */
+
+/*
+ * counter_mhz - Rate of the selected counter in ticks per microsecond.
+ *     The monotonic clock counts nanoseconds. An invariant TSC ticks at
+ *     a fixed rate that need not match the (frequency-scaled) "cpu MHz"
+ *     in /proc/cpuinfo, so we time it against CLOCK_MONOTONIC_RAW and
+ *     take the median of a few runs. Anything else falls back to mhz().
+ */
+double counter_mhz(int verbose)
+{
+    double rate[CALIBRATE_RUNS], t0, c0, tmp;
+    struct timespec nap = { 0, CALIBRATE_NS };
+    int i, j;
+
+    if (counter_source == COUNTER_MONOTONIC)
+        return 1000.0;
+    if (!tsc_invariant())
+        return mhz(verbose);
+
+    for (i = 0; i < CALIBRATE_RUNS; i++) {
+        t0 = mono_ns();
+        start_counter();
+        nanosleep(&nap, NULL);
+        c0 = get_counter();
+        rate[i] = c0 / ((mono_ns() - t0) / 1e3);
+    }
+
+    /* Insertion sort, to pick the median */
+    for (i = 1; i < CALIBRATE_RUNS; i++)
+        for (j = i; j > 0 && rate[j-1] > rate[j]; j--) {
+            tmp = rate[j-1];
+            rate[j-1] = rate[j];
+            rate[j] = tmp;
+        }
+
+    if (verbose)
+        printf("Invariant TSC rate ~= %.1f MHz\n", rate[CALIBRATE_RUNS/2]);
+    return rate[CALIBRATE_RUNS/2];
+}
+
 /** Special counters that compensate for timer interrupt overhead */
 
 static double cyc_per_tick = 0.0;
@@ -1,5 +1,19 @@
 /* Routines for using cycle counter */
 
+/* Sources for start_counter() and get_counter() */
+#define COUNTER_RDTSC     0  /* cycle counter (rdtsc on x86); the default */
+#define COUNTER_RDTSCP    1  /* x86 rdtscp, which waits for earlier insns */
+#define COUNTER_MONOTONIC 2  /* clock_gettime(CLOCK_MONOTONIC_RAW), in ns */
+
+/* Select the counter source; returns -1 if the CPU doesn't have it */
+int set_counter_source(int source);
+
+/* Return the current counter source */
+int get_counter_source();
+
+/* Does the CPU have a TSC that ticks at a constant rate? */
+int tsc_invariant();
+
 /* Start the counter */
 void start_counter();
 
@@ -15,6 +29,9 @@ double mhz(int verbose);
 /* Determine clock rate of processor, having more control over accuracy */
 double mhz_full(int verbose, int sleeptime);
 
+/* Determine the rate of the current counter source (ticks per usec) */
+double counter_mhz(int verbose);
+
 /** Special counters that compensate for timer interrupt overhead */
 
 void start_comp_counter();
@@ -112,9 +112,12 @@
 #define MAX_HEAP (100*(1<<20))  /* 100 MB */
 
 /*****************************************************************************
- * Set exactly one of these USE_xxx constants to "1" to select a timing method
+ * Set exactly one of these USE_xxx constants to "1" to select the default
+ * timing method. The driver can pick another one at runtime with -T.
  *****************************************************************************/
 #define USE_FCYC   1   /* cycle counter w/K-best scheme (x86 & Alpha only) */
+#define USE_TSC    0   /* invariant TSC via rdtscp w/K-best (modern x86) */
+#define USE_MONO   0   /* CLOCK_MONOTONIC_RAW w/K-best (Linux) */
 #define USE_ITIMER 0   /* interval timer (any Unix box) */
 #define USE_GETTOD 0   /* gettimeofday (any Unix box) */
 
@@ -8,11 +8,18 @@
  * the time in CPU cycles for a function f.
  */
 #include <stdlib.h>
+#include <limits.h>
+#include <string.h>
 #include <sys/times.h>
 #include <stdio.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
 #include "fcyc.h"
 #include "clock.h"
+#include "stats.h"
 
 /* Default values */
 #define K 3                  /* Value of K in K-best scheme */
@@ -20,8 +27,13 @@
 #define EPSILON 0.01         /* K samples should be EPSILON of each other*/
 #define COMPENSATE 0         /* 1-> try to compensate for clock ticks */
 #define CLEAR_CACHE 0        /* Clear cache before running test function */
-#define CACHE_BYTES (1<<19)  /* Max cache size in bytes */
-#define CACHE_BLOCK 32       /* Cache block size in bytes */
+#define CACHE_BYTES 0        /* Max cache size in bytes (0: detect) */
+#define CACHE_BLOCK 0        /* Cache block size in bytes (0: detect) */
+#define DEF_CACHE_BYTES (1<<19) /* ... if /sys doesn't tell us */
+#define DEF_CACHE_BLOCK 32
+#define SYSFS_CACHE "/sys/devices/system/cpu/cpu0/cache"
+#define WARMUP 0             /* Unmeasured runs before sampling */
+#define MINSAMPLES 0         /* Keep sampling until at least this many */
 
 static int kbest = K;
 static int maxsamples = MAXSAMPLES;
@@ -30,19 +42,20 @@ static int compensate = COMPENSATE;
 static int clear_cache = CLEAR_CACHE;
 static int cache_bytes = CACHE_BYTES;
 static int cache_block = CACHE_BLOCK;
+static int warmup = WARMUP;
+static int minsamples = MINSAMPLES;
 
 static int *cache_buf = NULL;
+static test_funct clear_func = NULL;
+static void *clear_arg = NULL;
 
 static double *values = NULL;
+static double *samples = NULL;  /* every sample, for the distribution */
 static int samplecount = 0;
+static fcyc_dist_t last_dist;
 
 /* for debugging only */
 #define KEEP_VALS 0
-#define KEEP_SAMPLES 0
-
-#if KEEP_SAMPLES
-static double *samples = NULL;
-#endif
 
 /* 
  * init_sampler - Start new sampling process 
@@ -52,12 +65,10 @@ static void init_sampler()
     if (values)
 	free(values);
     values = calloc(kbest, sizeof(double));
-#if KEEP_SAMPLES
     if (samples)
 	free(samples);
     /* Allocate extra for wraparound analysis */
     samples = calloc(maxsamples+kbest, sizeof(double));
-#endif
     samplecount = 0;
 }
 
@@ -74,9 +85,7 @@ static void add_sample(double val)
 	pos = kbest-1;
 	values[pos] = val;
     }
-#if KEEP_SAMPLES
     samples[samplecount] = val;
-#endif
     samplecount++;
     /* Insertion sort */
     while (pos > 0 && values[pos-1] > values[pos]) {
@@ -89,14 +98,97 @@ static void add_sample(double val)
 
 /* 
  * has_converged- Have kbest minimum measurements converged within epsilon? 
+ *     (and have we taken the minimum number of samples?)
  */
 static int has_converged()
 {
     return
 	(samplecount >= kbest) &&
+	(samplecount >= minsamples) &&
 	((1 + epsilon)*values[0] >= values[kbest-1]);
 }
 
+/*
+ * summarize - Record the distribution of all the samples taken
+ */
+static void summarize()
+{
+    int n = samplecount;
+
+    last_dist.samples = n;
+    last_dist.kbest = values[0];
+    last_dist.median = stats_median(samples, n);
+    last_dist.mad = stats_mad(samples, n);
+    stats_median_ci95(samples, n, &last_dist.ci_lo, &last_dist.ci_hi);
+}
+
+/*
+ * read_sysfs - Read one number from a cache description in sysfs,
+ *     scaling sizes like "48K" or "32M" to bytes. Returns -1 on error.
+ */
+static long long read_sysfs(int index, const char *attr)
+{
+    char path[256];
+    char unit = 0;
+    long long val;
+    FILE *fp;
+    int n;
+
+    sprintf(path, SYSFS_CACHE "/index%d/%s", index, attr);
+    if ((fp = fopen(path, "r")) == NULL)
+	return -1;
+    n = fscanf(fp, "%lld%c", &val, &unit);
+    fclose(fp);
+    if (n < 1)
+	return -1;
+    if (unit == 'K')
+	val <<= 10;
+    else if (unit == 'M')
+	val <<= 20;
+    else if (unit == 'G')
+	val <<= 30;
+    return val;
+}
+
+/*
+ * detect_cache - Size the clearing buffer from the cache topology in
+ *     sysfs: 1.5x the largest data (or unified) cache, walked with its
+ *     line size. Keeps the old defaults if there's nothing there.
+ */
+static void detect_cache()
+{
+    long long size, line, best = 0, best_line = 0;
+    char type[32];
+    char path[256];
+    FILE *fp;
+    int i;
+
+    for (i = 0; ; i++) {
+	sprintf(path, SYSFS_CACHE "/index%d/type", i);
+	if ((fp = fopen(path, "r")) == NULL)
+	    break;
+	if (fscanf(fp, "%31s", type) != 1)
+	    type[0] = 0;
+	fclose(fp);
+	if (type[0] == 'I')     /* instruction caches don't matter */
+	    continue;
+	size = read_sysfs(i, "size");
+	line = read_sysfs(i, "coherency_line_size");
+	if (size > best) {
+	    best = size;
+	    best_line = line;
+	}
+    }
+
+    if (cache_bytes == 0) {
+	best += best / 2;
+	cache_bytes = best <= 0 ? DEF_CACHE_BYTES :
+	    best > INT_MAX ? INT_MAX : (int)best;
+    }
+    if (cache_block == 0)
+	cache_block = best_line <= 0 ? DEF_CACHE_BLOCK : (int)best_line;
+}
+
 /* 
  * clear - Code to clear cache 
  */
@@ -106,13 +198,33 @@ static void clear()
 {
     int x = sink;
     int *cptr, *cend;
-    int incr = cache_block/sizeof(int);
-    if (!cache_buf) {
+    int incr;
+
+    if (clear_func) {
+	clear_func(clear_arg);
+	return;
+    }
+
+    if (cache_bytes == 0 || cache_block == 0)
+	detect_cache();
+    incr = cache_block/sizeof(int);
+    while (!cache_buf) {
 	cache_buf = malloc(cache_bytes);
 	if (!cache_buf) {
-	    fprintf(stderr, "Fatal error.  Malloc returned null when trying to clear cache\n");
-	    exit(1);
+	    if (cache_bytes <= DEF_CACHE_BYTES) {
+		fprintf(stderr, "Fatal error.  Malloc returned null when trying to clear cache\n");
+		exit(1);
+	    }
+	    /* settle for a smaller buffer than we'd like */
+	    cache_bytes /= 2;
+	    continue;
 	}
+	/*
+	 * A buffer this big is a fresh mmap whose pages all map the
+	 * kernel's zero page until written, and reading them would only
+	 * ever touch that one page
+	 */
+	memset(cache_buf, 1, cache_bytes);
     }
     cptr = (int *) cache_buf;
     cend = cptr + cache_bytes/sizeof(int);
@@ -123,13 +235,63 @@ static void clear()
     sink = x;
 }
 
+/*
+ * fcyc_flush - Evict every cache line of [p, p+len) from all levels of
+ *     the cache hierarchy, using clflushopt where the CPU has it
+ */
+#if defined(__i386__) || defined(__x86_64__)
+void fcyc_flush(const void *p, size_t len)
+{
+    static int have_clflushopt = -1;
+    unsigned eax, ebx, ecx, edx;
+    const char *cp, *end = (const char *)p + len;
+    int line;
+
+    if (have_clflushopt < 0) {
+	have_clflushopt = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+	    ((ebx >> 23) & 1);
+	if (cache_block == 0)
+	    detect_cache();
+    }
+    line = cache_block;
+
+    /* Flush from the first line that overlaps the buffer */
+    cp = (const char *)((unsigned long)p & ~(unsigned long)(line - 1));
+    if (have_clflushopt) {
+	for (; cp < end; cp += line)
+	    asm volatile("clflushopt %0" : "+m" (*(volatile char *)cp));
+    } else {
+	for (; cp < end; cp += line)
+	    asm volatile("clflush %0" : "+m" (*(volatile char *)cp));
+    }
+    /* clflushopt is weakly ordered; wait for the flushes to finish */
+    asm volatile("mfence" ::: "memory");
+}
+#else
+void fcyc_flush(const void *p __attribute__((unused)),
+		size_t len __attribute__((unused)))
+{
+    /* No way to flush single lines here; clear the whole cache instead */
+    test_funct f = clear_func;
+    clear_func = NULL;
+    clear();
+    clear_func = f;
+}
+#endif
+
 /*
  * fcyc - Use K-best scheme to estimate the running time of function f
  */
 double fcyc(test_funct f, void *argp)
 {
     double result;
+    int i;
     init_sampler();
+
+    /* Warm up caches, branch predictors and page tables first */
+    for (i = 0; i < warmup; i++)
+	f(argp);
+
     if (compensate) {
 	do {
 	    double cyc;
@@ -159,6 +321,7 @@ double fcyc(test_funct f, void *argp)
 	    printf("%.0f%s", values[i], i==kbest-1 ? "]\n" : ", ");
     }
 #endif
+    summarize();
     result = values[0];
 #if !KEEP_VALS
     free(values); 
@@ -168,6 +331,16 @@ double fcyc(test_funct f, void *argp)
 }
 
 
+/*
+ * fcyc_last_dist - Distribution of the samples taken by the last call
+ *     to fcyc, in cycles
+ */
+void fcyc_last_dist(fcyc_dist_t *dist)
+{
+    *dist = last_dist;
+}
+
+
 /*************************************************************
  * Set the various parameters used by the measurement routines 
  ************************************************************/
@@ -184,7 +357,8 @@ void set_fcyc_clear_cache(int clear)
 
 /* 
  * set_fcyc_cache_size - Set size of cache to use when clearing cache 
- *     Default = 1<<19 (512KB)
+ *     Default = 1.5x the largest data cache listed in
+ *     /sys/devices/system/cpu, or 1<<19 (512KB) if there is none
  */
 void set_fcyc_cache_size(int bytes)
 {
@@ -199,12 +373,24 @@ void set_fcyc_cache_size(int bytes)
 
 /* 
  * set_fcyc_cache_block - Set size of cache block 
- *     Default = 32
+ *     Default = line size of that cache, or 32
  */
 void set_fcyc_cache_block(int bytes) {
     cache_block = bytes;
 }
 
+/* 
+ * set_fcyc_clear_func - When set (and clearing is on), call f(argp)
+ *     to clear the cache instead of walking a buffer, e.g. to flush
+ *     just the data under test with fcyc_flush.
+ *     Default = NULL
+ */
+void set_fcyc_clear_func(test_funct f, void *argp)
+{
+    clear_func = f;
+    clear_arg = argp;
+}
+
 
 /* 
  * set_fcyc_compensate- When set, will attempt to compensate for 
@@ -245,6 +431,25 @@ void set_fcyc_epsilon(double epsilon_arg)
     epsilon = epsilon_arg;
 }
 
+/* 
+ * set_fcyc_warmup - Number of unmeasured runs of f before sampling
+ *     Default = 0
+ */
+void set_fcyc_warmup(int warmup_arg)
+{
+    warmup = warmup_arg;
+}
+
+/* 
+ * set_fcyc_minsamples - Minimum number of samples to take even when
+ *     K-best has converged, so the distribution is meaningful.
+ *     Default = 0
+ */
+void set_fcyc_minsamples(int minsamples_arg)
+{
+    minsamples = minsamples_arg;
+}
+
 
 
 
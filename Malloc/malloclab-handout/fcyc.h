@@ -7,12 +7,33 @@
  *
  */
 
+#include <stddef.h>
+
 /* The test function takes a generic pointer as input */
 typedef void (*test_funct)(void *);
 
 /* Compute number of cycles used by test function f */
 double fcyc(test_funct f, void* argp);
 
+/* Distribution of the samples taken by one call to fcyc, in cycles */
+typedef struct {
+    int samples;    /* number of samples taken */
+    double kbest;   /* the K-best estimate that fcyc returned */
+    double median;  /* median sample */
+    double mad;     /* median absolute deviation from the median */
+    double ci_lo;   /* 95% confidence interval for the median */
+    double ci_hi;
+} fcyc_dist_t;
+
+/* fcyc_last_dist - Get the distribution of the last call to fcyc */
+void fcyc_last_dist(fcyc_dist_t *dist);
+
+/*
+ * fcyc_flush - Evict [p, p+len) from every level of the cache
+ *     (clflushopt/clflush on x86; clears the whole cache elsewhere)
+ */
+void fcyc_flush(const void *p, size_t len);
+
 /*********************************************************
  * Set the various parameters used by measurement routines 
  *********************************************************/
@@ -26,16 +47,25 @@ void set_fcyc_clear_cache(int clear);
 
 /* 
  * set_fcyc_cache_size - Set size of cache to use when clearing cache 
- *     Default = 1<<19 (512KB)
+ *     Default = 1.5x the largest data cache listed in
+ *     /sys/devices/system/cpu, or 1<<19 (512KB) if there is none
  */
 void set_fcyc_cache_size(int bytes);
 
 /* 
  * set_fcyc_cache_block - Set size of cache block 
- *     Default = 32
+ *     Default = line size of that cache, or 32
  */
 void set_fcyc_cache_block(int bytes);
 
+/* 
+ * set_fcyc_clear_func - When set (and clearing is on), call f(argp)
+ *     to clear the cache instead of walking a buffer, e.g. to flush
+ *     just the data under test with fcyc_flush.
+ *     Default = NULL
+ */
+void set_fcyc_clear_func(test_funct f, void *argp);
+
 /* 
  * set_fcyc_compensate- When set, will attempt to compensate for 
  *     timer interrupt overhead 
@@ -63,6 +93,19 @@ void set_fcyc_maxsamples(int maxsamples_arg);
  */
 void set_fcyc_epsilon(double epsilon_arg);
 
+/* 
+ * set_fcyc_warmup - Number of unmeasured runs of f before sampling
+ *     Default = 0
+ */
+void set_fcyc_warmup(int warmup_arg);
+
+/* 
+ * set_fcyc_minsamples - Minimum number of samples to take even when
+ *     K-best has converged, so the distribution is meaningful.
+ *     Default = 0
+ */
+void set_fcyc_minsamples(int minsamples_arg);
+
 
 
 
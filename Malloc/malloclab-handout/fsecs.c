@@ -1,17 +1,94 @@
 /****************************
  * High-level timing wrappers
  ****************************/
+#define _GNU_SOURCE /* for sched_setaffinity */
 #include <stdio.h>
+#include <string.h>
+#include <sched.h>
 #include "fsecs.h"
 #include "fcyc.h"
 #include "clock.h"
 #include "ftimer.h"
 #include "config.h"
 
+#if USE_FCYC
+#define DEFAULT_METHOD FSECS_FCYC
+#elif USE_TSC
+#define DEFAULT_METHOD FSECS_TSC
+#elif USE_MONO
+#define DEFAULT_METHOD FSECS_MONO
+#elif USE_ITIMER
+#define DEFAULT_METHOD FSECS_ITIMER
+#elif USE_GETTOD
+#define DEFAULT_METHOD FSECS_GETTOD
+#endif
+
 static double Mhz;  /* estimated CPU clock frequency */
 
+static int method = DEFAULT_METHOD;
+static int pin_cpu = -1;
+static int warmup = 0;
+static int minsamples = 0;
+static fsecs_dist_t last_dist;
+
+static const char *method_names[] = {
+    "fcyc", "tsc", "mono", "itimer", "gettod"
+};
+#define NMETHODS (int)(sizeof(method_names) / sizeof(method_names[0]))
+
 extern int verbose; /* -v option in mdriver.c */
 
+int fsecs_method(const char *name)
+{
+    int i;
+
+    for (i = 0; i < NMETHODS; i++)
+        if (strcmp(name, method_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+const char *fsecs_method_name(int m)
+{
+    return (m >= 0 && m < NMETHODS) ? method_names[m] : "?";
+}
+
+void set_fsecs_method(int m)
+{
+    method = m;
+}
+
+void set_fsecs_cpu(int cpu)
+{
+    pin_cpu = cpu;
+}
+
+void set_fsecs_warmup(int runs)
+{
+    warmup = runs;
+}
+
+void set_fsecs_samples(int samples)
+{
+    minsamples = samples;
+}
+
+/*
+ * pin - Bind this process to one CPU, so the measurements aren't
+ *     spread across cores with different caches and clock rates
+ */
+static void pin(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0)
+        printf("Warning: could not pin to CPU %d\n", cpu);
+    else if (verbose)
+        printf("Pinned to CPU %d.\n", cpu);
+}
+
 /*
  * init_fsecs - initialize the timing package
  */
@@ -19,24 +96,53 @@ void init_fsecs(void)
 {
     Mhz = 0; /* keep gcc -Wall happy */
 
-#if USE_FCYC
-    if (verbose)
-	printf("Measuring performance with a cycle counter.\n");
-
-    /* set key parameters for the fcyc package */
-    set_fcyc_maxsamples(20); 
-    set_fcyc_clear_cache(1);
-    set_fcyc_compensate(1);
-    set_fcyc_epsilon(0.01);
-    set_fcyc_k(3);
-    Mhz = mhz(verbose > 0);
-#elif USE_ITIMER
-    if (verbose)
-	printf("Measuring performance with the interval timer.\n");
-#elif USE_GETTOD
-    if (verbose)
-	printf("Measuring performance with gettimeofday().\n");
-#endif
+    if (pin_cpu >= 0)
+        pin(pin_cpu);
+
+    if (method == FSECS_TSC &&
+        (!tsc_invariant() || set_counter_source(COUNTER_RDTSCP) < 0)) {
+        printf("Warning: no invariant TSC with rdtscp, "
+               "using the monotonic clock\n");
+        method = FSECS_MONO;
+    }
+
+    switch (method) {
+    case FSECS_FCYC:
+    case FSECS_TSC:
+    case FSECS_MONO:
+        if (verbose)
+            printf("Measuring performance with %s.\n",
+                   method == FSECS_FCYC ? "a cycle counter" :
+                   method == FSECS_TSC ? "the invariant TSC" :
+                   "CLOCK_MONOTONIC_RAW");
+
+        /* set key parameters for the fcyc package */
+        set_fcyc_maxsamples(minsamples > 20 ? minsamples : 20);
+        set_fcyc_minsamples(minsamples);
+        set_fcyc_warmup(warmup);
+        set_fcyc_clear_cache(1);
+        set_fcyc_epsilon(0.01);
+        set_fcyc_k(3);
+        if (method == FSECS_FCYC) {
+            set_fcyc_compensate(1);
+            Mhz = mhz(verbose > 0);
+        } else {
+            /* these clocks don't need the timer interrupt fudge */
+            set_fcyc_compensate(0);
+            if (method == FSECS_MONO)
+                set_counter_source(COUNTER_MONOTONIC);
+            Mhz = counter_mhz(verbose > 0);
+        }
+        break;
+    case FSECS_ITIMER:
+        if (verbose)
+            printf("Measuring performance with the interval timer.\n");
+        break;
+    case FSECS_GETTOD:
+        if (verbose)
+            printf("Measuring performance with gettimeofday().\n");
+        break;
+    }
 }
 
 /*
@@ -44,14 +150,35 @@ void init_fsecs(void)
  */
 double fsecs(fsecs_test_funct f, void *argp) 
 {
-#if USE_FCYC
-    double cycles = fcyc(f, argp);
-    return cycles/(Mhz*1e6);
-#elif USE_ITIMER
-    return ftimer_itimer(f, argp, 10);
-#elif USE_GETTOD
-    return ftimer_gettod(f, argp, 10);
-#endif 
-}
+    double cycles, scale;
+    fcyc_dist_t dist;
 
+    switch (method) {
+    case FSECS_ITIMER:
+        last_dist.samples = 0;
+        return ftimer_itimer(f, argp, 10);
+    case FSECS_GETTOD:
+        last_dist.samples = 0;
+        return ftimer_gettod(f, argp, 10);
+    default:
+        cycles = fcyc(f, argp);
+        scale = 1.0 / (Mhz*1e6);
+        fcyc_last_dist(&dist);
+        last_dist.samples = dist.samples;
+        last_dist.kbest = dist.kbest * scale;
+        last_dist.median = dist.median * scale;
+        last_dist.mad = dist.mad * scale;
+        last_dist.ci_lo = dist.ci_lo * scale;
+        last_dist.ci_hi = dist.ci_hi * scale;
+        return cycles * scale;
+    }
+}
 
+/*
+ * fsecs_last_dist - Distribution of the samples behind the last call
+ *     to fsecs (samples is 0 for the itimer and gettod methods)
+ */
+void fsecs_last_dist(fsecs_dist_t *dist)
+{
+    *dist = last_dist;
+}
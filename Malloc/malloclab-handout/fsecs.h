@@ -1,4 +1,30 @@
 typedef void (*fsecs_test_funct)(void *);
 
+/* Timing methods; the default is chosen by the USE_xxx switches in config.h */
+#define FSECS_FCYC   0  /* cycle counter w/K-best, /proc/cpuinfo clock rate */
+#define FSECS_TSC    1  /* invariant TSC via rdtscp w/K-best, calibrated rate */
+#define FSECS_MONO   2  /* CLOCK_MONOTONIC_RAW w/K-best */
+#define FSECS_ITIMER 3  /* interval timer */
+#define FSECS_GETTOD 4  /* gettimeofday */
+
+/* Distribution of the samples behind the last fsecs() result, in secs */
+typedef struct {
+    int samples;    /* 0 if the timing method doesn't keep samples */
+    double kbest, median, mad, ci_lo, ci_hi;
+} fsecs_dist_t;
+
+/* Return the method with the given name (e.g. "tsc"), or -1 */
+int fsecs_method(const char *name);
+
+/* Return the name of a method */
+const char *fsecs_method_name(int method);
+
+/* These must be called before init_fsecs() */
+void set_fsecs_method(int method);  /* timing method */
+void set_fsecs_cpu(int cpu);        /* pin to this CPU (-1: don't pin) */
+void set_fsecs_warmup(int runs);    /* unmeasured runs before sampling */
+void set_fsecs_samples(int samples);/* minimum samples per measurement */
+
 void init_fsecs(void);
 double fsecs(fsecs_test_funct f, void *argp);
+void fsecs_last_dist(fsecs_dist_t *dist);
@@ -8,6 +8,7 @@
  * May not be used, modified, or copied without permission.
  */
 #include <assert.h>
+#include <dlfcn.h>
 #include <errno.h>
 #include <float.h>
 #include <setjmp.h>
@@ -23,6 +24,10 @@
 #include "mm.h"
 #include "memlib.h"
 #include "fsecs.h"
+#include "fcyc.h"
+#include "perfctr.h"
+#include "stats.h"
+#include "bound.h"
 #include "config.h"
 
 /**********************
@@ -37,6 +42,10 @@
 /* Returns true if p is ALIGNMENT-byte aligned */
 #define IS_ALIGNED(p)  ((((unsigned long)(p)) % ALIGNMENT) == 0)
 
+/* A/B comparison mode (-a) */
+#define AB_TRIALS      10 /* default number of timing trials per package */
+#define AB_THRESHOLD  5.0 /* default regression threshold (percent) */
+
 /* weights */
 #define WNONE 0
 #define WALL 1
@@ -92,6 +101,29 @@ typedef struct {
     range_t *ranges;
 } speed_t;
 
+/*
+ * The entry points of an mm malloc package. Normally these are the
+ * functions linked in from mm.c, but with -a they can come from a
+ * shared object loaded at run time instead.
+ */
+typedef struct {
+    const char *name;
+    int (*init)(void);
+    void *(*malloc)(size_t size);
+    void (*free)(void *ptr);
+    void *(*realloc)(void *ptr, size_t size);
+    int (*checkheap)(int verbose);
+} mm_ops_t;
+
+/* Placement locality of the mm package on one trace (-L) */
+typedef struct {
+    int meta;            /* did mm.c report its metadata accesses? */
+    double meta_lines;   /* distinct cache lines of metadata touched */
+    double meta_pages;   /* distinct pages of metadata touched */
+    double alloc_dist;   /* mean |addr| distance between consecutive allocs */
+    double peak_pages;   /* most pages holding live payload at once */
+} locality_t;
+
 /* Summarizes the important stats for some malloc function on some trace */
 typedef struct {
     /* set in read_trace */
@@ -106,6 +138,23 @@ typedef struct {
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
 
+    /* distribution of the timing samples behind secs */
+    fsecs_dist_t dist;
+
+    /* set only with -P: event counts for one run, -1 if unavailable */
+    double events[PERFCTR_NEVENTS];
+
+    /* set only with -G: util and mem_sbrk calls under each growth policy */
+    int growth_valid[MM_GROW_POLICIES];
+    double growth_util[MM_GROW_POLICIES];
+    double growth_sbrks[MM_GROW_POLICIES];
+
+    /* set only with -B: offline bounds on the heap for this trace */
+    bound_t bound;
+
+    /* set only with -L: placement locality of one untimed run */
+    locality_t loc;
+
     /* Note: secs and util are only defined if valid is true */
 } stats_t;
 
@@ -137,6 +186,66 @@ int onetime_flag = 0;
 /* by default, no timeouts */
 static int set_timeout = 0;
 
+/* the mm package being evaluated; the one linked in by default */
+static mm_ops_t mm_linked = {
+    "mm.c", mm_init, mm_malloc, mm_free, mm_realloc, mm_checkheap
+};
+static const mm_ops_t *mm = &mm_linked;
+
+/* A/B comparison mode: packages loaded with -a and how to compare them */
+static mm_ops_t ab_ops[2];
+static int ab_count = 0;
+static int ab_trials = AB_TRIALS;
+static double ab_threshold = AB_THRESHOLD;
+static char *ab_json = NULL;  /* JSON output file, or "-" for stdout */
+
+/* if set, report the distribution of the timing samples (-R) */
+static int report_dist = 0;
+#define DIST_SAMPLES 15 /* samples per measurement for -R */
+
+/* How to make the cache cold before each timing sample (-C) */
+#define CLEAR_WALK  0   /* walk a buffer larger than the LLC */
+#define CLEAR_FLUSH 1   /* clflush just the simulated heap */
+#define CLEAR_NONE  2   /* leave the cache warm */
+static int clear_mode = CLEAR_WALK;
+
+/* Heap growth policy for mm.c, and whether to compare them all (-G) */
+static int growth_report = 0;
+static int growth_all = 0;
+static int growth_policy = MM_GROW_FIXED;
+static int growth_pct = 0;    /* 0: mm.c's default cap */
+static const char *growth_names[MM_GROW_POLICIES] = {
+    "fixed", "geometric", "adaptive"
+};
+
+/* Size class table for mm.c: a file, or tuned during a warm-up (-S) */
+static char *class_file = NULL;
+static int class_warmup = 0;
+#define CLASS_WARMUP 1000 /* default mallocs sampled by -S auto */
+
+/* if set, compare utilization with offline bounds for each trace (-B) */
+static int show_bound = 0;
+
+/* if set, measure placement locality for each trace (-L) */
+static int locality = 0;
+#define LOC_LINE 64    /* cache line and page size for the -L metrics */
+#define LOC_PAGE 4096
+#define LOC_LINES (MAX_HEAP / LOC_LINE)
+#define LOC_PAGES (MAX_HEAP / LOC_PAGE)
+static int loc_tracking = 0;       /* set while eval_mm_locality runs */
+static int loc_meta = 0;           /* mm_meta_touch was called */
+static unsigned char loc_line_map[LOC_LINES / 8];
+static unsigned char loc_page_map[LOC_PAGES / 8];
+static int loc_live[LOC_PAGES];    /* live payload blocks on each page */
+static int loc_live_pages;
+
+/* if set, write every block after allocating it in the timed runs (-w) */
+static int touch_payload = 0;
+
+/* if set, count hardware events for each trace (-P) */
+static int perf_events = 0;
+static perfctr_t perfctr;
+
 
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
@@ -178,9 +287,33 @@ static void eval_libc_speed(void *ptr);
 static int eval_mm_valid(trace_t *trace, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum);
 static void eval_mm_speed(void *ptr);
+static void eval_mm_locality(trace_t *trace, int tracenum, locality_t *loc);
+static void eval_mm_growth(trace_t *trace, int tracenum, range_t **ranges,
+                           stats_t *stats);
+static void eval_bound(trace_t *trace, bound_t *bound);
+
+/* Routines for the A/B comparison of two mm packages */
+static void load_mm(const char *path, mm_ops_t *ops);
+
+/* Routine for loading a size class table for mm.c */
+static void load_classes(const char *path);
+static int run_compare(int num_tracefiles, const char *tracedir,
+                       char **tracefiles, range_t *ranges,
+                       speed_t *speed_params);
+
+/* Routine for counting hardware events over one run of a trace */
+static void count_events(void (*f)(void *), void *argp, stats_t *stats);
+
+/* Cache clearing routine for -C flush */
+static void flush_heap(void *argp);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printevents(int n, stats_t *stats);
+static void printdist(int n, stats_t *stats);
+static void printlocality(int n, stats_t *stats);
+static void printgrowth(int n, stats_t *stats);
+static void printbound(int n, stats_t *stats);
 static void usage(void);
 static void malloc_error(const trace_t *trace, int opnum, const char *fmt, ...)
     __attribute__((format(printf, 3,4)));
@@ -235,12 +368,27 @@ static void run_tests(int num_tracefiles, const char *tracedir,
         if (mm_stats[i].valid) {
             if (verbose > 1)
                 printf("efficiency, ");
+            if (mm_stats_reset)
+                mm_stats_reset();
             mm_stats[i].util = eval_mm_util(trace, i);
+            if (mm_stats_dump) {
+                printf("\nmm.c counters for %s:\n", trace->filename);
+                mm_stats_dump(stdout);
+            }
+            if (growth_report)
+                eval_mm_growth(trace, i, &ranges, &mm_stats[i]);
+            if (show_bound)
+                eval_bound(trace, &mm_stats[i].bound);
+            if (locality)
+                eval_mm_locality(trace, i, &mm_stats[i].loc);
             speed_params->trace = trace;
             speed_params->ranges = ranges;
             if (verbose > 1)
                 printf("and performance.\n");
             mm_stats[i].secs = fsecs(eval_mm_speed, speed_params);
+            fsecs_last_dist(&mm_stats[i].dist);
+            if (perf_events)
+                count_events(eval_mm_speed, speed_params, &mm_stats[i]);
         }
 
         free_trace(trace);
@@ -280,7 +428,7 @@ int main(int argc, char **argv)
     /*
      * Read and interpret the command line arguments
      */
-    while ((c = getopt(argc, argv, "d:f:c:s:t:v:hVAlD")) != EOF) {
+    while ((c = getopt(argc, argv, "a:d:f:c:s:t:v:hVAlDPn:r:j:T:p:W:RC:LwG:S:B")) != EOF) {
         switch (c) {
 
         case 'A': /* Hidden Autolab driver argument */
@@ -338,6 +486,104 @@ int main(int argc, char **argv)
             set_timeout = atoi(optarg);
             break;
 
+        case 'P': /* Count hardware events */
+            perf_events = 1;
+            break;
+
+        case 'a': /* Load an mm package to compare (at most twice) */
+            if (ab_count == 2)
+                app_error("ERROR: -a can be given at most twice\n");
+            load_mm(optarg, &ab_ops[ab_count++]);
+            break;
+
+        case 'n': /* Number of A/B timing trials */
+            ab_trials = atoi(optarg);
+            if (ab_trials < 1)
+                app_error("ERROR: -n needs at least one trial\n");
+            break;
+
+        case 'r': /* A/B regression threshold in percent */
+            ab_threshold = atof(optarg);
+            break;
+
+        case 'j': /* A/B results as JSON */
+            ab_json = optarg;
+            break;
+
+        case 'T': /* Timing method */
+            if ((i = fsecs_method(optarg)) < 0)
+                app_error("ERROR: unknown timing method %s\n", optarg);
+            set_fsecs_method(i);
+            break;
+
+        case 'p': /* Pin to a CPU */
+            set_fsecs_cpu(atoi(optarg));
+            break;
+
+        case 'W': /* Warm-up runs before timing */
+            set_fsecs_warmup(atoi(optarg));
+            break;
+
+        case 'R': /* Report the timing distribution */
+            report_dist = 1;
+            set_fsecs_samples(DIST_SAMPLES);
+            break;
+
+        case 'G': /* Heap growth policy: name[,pct] or all[,pct] */
+            {
+                char *comma = strchr(optarg, ',');
+                if (comma) {
+                    *comma = '\0';
+                    growth_pct = atoi(comma + 1);
+                }
+                growth_report = 1;
+                if (strcmp(optarg, "all") == 0) {
+                    growth_all = 1;
+                } else {
+                    for (i = 0; i < MM_GROW_POLICIES; i++)
+                        if (strcmp(optarg, growth_names[i]) == 0)
+                            break;
+                    if (i == MM_GROW_POLICIES)
+                        app_error("ERROR: unknown growth policy %s\n", optarg);
+                    growth_policy = i;
+                }
+            }
+            break;
+
+        case 'S': /* Size classes: a table file, or auto[,mallocs] */
+            if (strncmp(optarg, "auto", 4) == 0 &&
+                (optarg[4] == '\0' || optarg[4] == ',')) {
+                class_warmup = optarg[4] ? atoi(optarg + 5) : CLASS_WARMUP;
+                if (class_warmup <= 0)
+                    app_error("ERROR: bad warm-up length in -S %s\n", optarg);
+            } else {
+                class_file = optarg;
+            }
+            break;
+
+        case 'B': /* Compare utilization with offline bounds */
+            show_bound = 1;
+            break;
+
+        case 'L': /* Measure placement locality */
+            locality = 1;
+            break;
+
+        case 'w': /* Write every allocated block while timing */
+            touch_payload = 1;
+            break;
+
+        case 'C': /* How to clear the cache between samples */
+            if (strcmp(optarg, "walk") == 0)
+                clear_mode = CLEAR_WALK;
+            else if (strcmp(optarg, "flush") == 0)
+                clear_mode = CLEAR_FLUSH;
+            else if (strcmp(optarg, "none") == 0)
+                clear_mode = CLEAR_NONE;
+            else
+                app_error("ERROR: unknown cache clearing mode %s\n", optarg);
+            break;
+
         case 'h': /* Print this message */
             usage();
             exit(0);
@@ -348,6 +594,20 @@ int main(int argc, char **argv)
         }
     }
 
+    if (growth_report) {
+        if (!mm_set_growth)
+            app_error("ERROR: mm.c has no mm_set_growth, can't use -G\n");
+        mm_set_growth(growth_policy, growth_pct);
+    }
+
+    if (class_file)
+        load_classes(class_file);
+    if (class_warmup) {
+        if (!mm_set_class_warmup)
+            app_error("ERROR: mm.c has no mm_set_class_warmup, can't use -S auto\n");
+        mm_set_class_warmup(class_warmup);
+    }
+
     if (tracefiles == NULL) {
         tracefiles = default_tracefiles;
         num_tracefiles = sizeof(default_tracefiles) / sizeof(char *) - 1;
@@ -360,6 +620,10 @@ int main(int argc, char **argv)
 
     /* Initialize the timing package */
     init_fsecs();
+    if (clear_mode == CLEAR_FLUSH)
+        set_fcyc_clear_func(flush_heap, NULL);
+    else if (clear_mode == CLEAR_NONE)
+        set_fcyc_clear_cache(0);
 
     /* Initialize the timeout */
     if (set_timeout > 0) {
@@ -367,6 +631,33 @@ int main(int argc, char **argv)
         alarm(set_timeout);
     }
 
+    /*
+     * In A/B mode, compare two mm packages instead of grading one. A
+     * single -a compares the package against the linked-in mm.c.
+     */
+    if (ab_count > 0) {
+        if (ab_count == 1) {
+            ab_ops[1] = ab_ops[0];
+            ab_ops[0] = mm_linked;
+        }
+        exit(run_compare(num_tracefiles, tracedir, tracefiles,
+                         ranges, &speed_params) > 0 ? 2 : 0);
+    }
+
+    /*
+     * Open the event counters, falling back to software events only.
+     * A/B mode above doesn't count events.
+     */
+    if (perf_events) {
+        if (perfctr_open(&perfctr) == 0) {
+            printf("Warning: no performance counters available, ignoring -P\n");
+            perf_events = 0;
+        } else if (perfctr.nhw == 0) {
+            printf("Warning: hardware events not permitted, "
+                   "counting software events only\n");
+        }
+    }
+
     /*
      * Optionally run and evaluate the libc malloc package
      */
@@ -391,6 +682,9 @@ int main(int argc, char **argv)
                 if (verbose > 1)
                     printf("and performance.\n");
                 libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+                fsecs_last_dist(&libc_stats[i].dist);
+                if (perf_events)
+                    count_events(eval_libc_speed, &speed_params, &libc_stats[i]);
             }
             free_trace(trace);
         }
@@ -399,6 +693,10 @@ int main(int argc, char **argv)
         if (verbose) {
             printf("\nResults for libc malloc:\n");
             printresults(num_tracefiles, libc_stats);
+            if (report_dist)
+                printdist(num_tracefiles, libc_stats);
+            if (perf_events)
+                printevents(num_tracefiles, libc_stats);
         }
     }
 
@@ -429,6 +727,16 @@ int main(int argc, char **argv)
         } else {
             printf("\nResults for mm malloc:\n");
             printresults(num_tracefiles, mm_stats);
+            if (report_dist)
+                printdist(num_tracefiles, mm_stats);
+            if (locality)
+                printlocality(num_tracefiles, mm_stats);
+            if (growth_report)
+                printgrowth(num_tracefiles, mm_stats);
+            if (show_bound)
+                printbound(num_tracefiles, mm_stats);
+            if (perf_events)
+                printevents(num_tracefiles, mm_stats);
             printf("\n");
         }
     }
@@ -541,6 +849,8 @@ int main(int argc, char **argv)
         printf("\nAUTORESULT_STRING=%s\n", autoresult);
     }
 
+    if (perf_events)
+        perfctr_close(&perfctr);
     exit(0);
 }
 
@@ -859,7 +1169,7 @@ static int eval_mm_valid(trace_t *trace, range_t **ranges)
     reinit_trace(trace);
 
     /* Call the mm package's init function */
-    if (mm_init() < 0) {
+    if (mm->init() < 0) {
         malloc_error(trace, 0, "mm_init failed.");
         return 0;
     }
@@ -873,7 +1183,7 @@ static int eval_mm_valid(trace_t *trace, range_t **ranges)
             range_t *r;
 
             /* Let the students check their own heap */
-            mm_checkheap(verbose);
+            mm->checkheap(verbose);
 
             /* Now check that all our allocated blocks have the right data */
             r = *ranges;
@@ -888,7 +1198,7 @@ static int eval_mm_valid(trace_t *trace, range_t **ranges)
         case ALLOC: /* mm_malloc */
 
             /* Call the student's malloc */
-            if ((p = mm_malloc(size)) == NULL) {
+            if ((p = mm->malloc(size)) == NULL) {
                 malloc_error(trace, i, "mm_malloc failed.");
                 return 0;
             }
@@ -914,7 +1224,7 @@ static int eval_mm_valid(trace_t *trace, range_t **ranges)
 
             /* Call the student's realloc */
             oldp = trace->blocks[index];
-            newp = mm_realloc(oldp, size);
+            newp = mm->realloc(oldp, size);
             if( (newp == NULL) && (size != 0) ) {
                 malloc_error(trace, i, "mm_realloc failed.");
                 return 0;
@@ -959,7 +1269,7 @@ static int eval_mm_valid(trace_t *trace, range_t **ranges)
                 p = trace->blocks[index];
                 remove_range(ranges, p);
             }
-            mm_free(p);
+            mm->free(p);
             break;
 
         default:
@@ -998,7 +1308,7 @@ static double eval_mm_util(trace_t *trace, int tracenum)
 
     /* initialize the heap and the mm malloc package */
     mem_reset_brk();
-    if (mm_init() < 0)
+    if (mm->init() < 0)
         app_error("trace %d: mm_init failed in eval_mm_util", tracenum);
 
     for (i = 0;  i < trace->num_ops;  i++) {
@@ -1008,7 +1318,7 @@ static double eval_mm_util(trace_t *trace, int tracenum)
             index = trace->ops[i].index;
             size = trace->ops[i].size;
 
-            if ((p = mm_malloc(size)) == NULL) {
+            if ((p = mm->malloc(size)) == NULL) {
                 app_error("trace %d: mm_malloc failed in eval_mm_util",
                           tracenum);
             }
@@ -1026,7 +1336,7 @@ static double eval_mm_util(trace_t *trace, int tracenum)
             oldsize = trace->block_sizes[index];
 
             oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL && newsize != 0) {
+            if ((newp = mm->realloc(oldp,newsize)) == NULL && newsize != 0) {
                 app_error("trace %d: mm_realloc failed in eval_mm_util",
                           tracenum);
             }
@@ -1048,7 +1358,7 @@ static double eval_mm_util(trace_t *trace, int tracenum)
                 p = trace->blocks[index];
             }
 
-            mm_free(p);
+            mm->free(p);
 
             total_size -= size;
             break;
@@ -1082,7 +1392,7 @@ static void eval_mm_speed(void *ptr)
 
     /* Reset the heap and initialize the mm package */
     mem_reset_brk();
-    if (mm_init() < 0)
+    if (mm->init() < 0)
         app_error("mm_init failed in eval_mm_speed");
 
     /* Interpret each trace request */
@@ -1092,8 +1402,10 @@ static void eval_mm_speed(void *ptr)
         case ALLOC: /* mm_malloc */
             index = trace->ops[i].index;
             size = trace->ops[i].size;
-            if ((p = mm_malloc(size)) == NULL)
+            if ((p = mm->malloc(size)) == NULL)
                 app_error("mm_malloc error in eval_mm_speed");
+            if (touch_payload)
+                memset(p, index, size);
             trace->blocks[index] = p;
             break;
 
@@ -1101,8 +1413,10 @@ static void eval_mm_speed(void *ptr)
             index = trace->ops[i].index;
             newsize = trace->ops[i].size;
             oldp = trace->blocks[index];
-            if ((newp = mm_realloc(oldp,newsize)) == NULL && newsize != 0)
+            if ((newp = mm->realloc(oldp,newsize)) == NULL && newsize != 0)
                 app_error("mm_realloc error in eval_mm_speed");
+            if (touch_payload && newp != NULL)
+                memset(newp, index, newsize);
             trace->blocks[index] = newp;
             break;
 
@@ -1113,7 +1427,7 @@ static void eval_mm_speed(void *ptr)
             } else {
                 block = trace->blocks[index];
             }
-            mm_free(block);
+            mm->free(block);
             break;
 
         default:
@@ -1121,6 +1435,206 @@ static void eval_mm_speed(void *ptr)
         }
 }
 
+/*
+ * eval_mm_growth - Record the utilization and number of mem_sbrk calls
+ *    of the utilization run just done with the selected growth policy,
+ *    and with -G all, check and repeat that run under each of the other
+ *    policies
+ */
+static void eval_mm_growth(trace_t *trace, int tracenum, range_t **ranges,
+                           stats_t *stats)
+{
+    int p;
+
+    stats->growth_valid[growth_policy] = 1;
+    stats->growth_util[growth_policy] = stats->util;
+    stats->growth_sbrks[growth_policy] = mem_sbrk_calls();
+    if (!growth_all)
+        return;
+
+    for (p = 0; p < MM_GROW_POLICIES; p++) {
+        if (p == growth_policy)
+            continue;
+        mm_set_growth(p, growth_pct);
+        if (!(stats->growth_valid[p] = eval_mm_valid(trace, ranges)))
+            continue;
+        stats->growth_util[p] = eval_mm_util(trace, tracenum);
+        stats->growth_sbrks[p] = mem_sbrk_calls();
+    }
+    mm_set_growth(growth_policy, growth_pct);
+}
+
+/*
+ * eval_bound - Compute the offline heap bounds for a trace (see bound.c),
+ *    using mm.c's header, alignment and minimum block size
+ */
+static void eval_bound(trace_t *trace, bound_t *bound)
+{
+    bound_params_t params;
+    bound_op_t *ops;
+    int i;
+
+    if ((ops = malloc(trace->num_ops * sizeof(bound_op_t))) == NULL)
+        unix_error("malloc failed in eval_bound");
+    for (i = 0; i < trace->num_ops; i++) {
+        ops[i].type = trace->ops[i].type == ALLOC ? BOUND_ALLOC :
+            trace->ops[i].type == REALLOC ? BOUND_REALLOC : BOUND_FREE;
+        ops[i].index = trace->ops[i].index;
+        ops[i].size = trace->ops[i].size;
+    }
+
+    bound_default_params(&params);
+    if (bound_trace(ops, trace->num_ops, trace->num_ids, &params, bound) < 0)
+        unix_error("bound_trace failed");
+    free(ops);
+}
+
+/*
+ * mm_meta_touch - Called by an mm package built with -DMM_LOCALITY
+ *    for each access to its own metadata (headers, footers, free list
+ *    links and heads). Marks the lines and pages of the simulated heap
+ *    that were touched while eval_mm_locality is running.
+ */
+void mm_meta_touch(const void *p, size_t len)
+{
+    long lo, hi, i;
+
+    if (!loc_tracking || len == 0)
+        return;
+    loc_meta = 1;
+    lo = (const char *)p - (const char *)mem_heap_lo();
+    hi = lo + (long)len - 1;
+    if (lo < 0 || hi >= MAX_HEAP)
+        return;
+    for (i = lo / LOC_LINE; i <= hi / LOC_LINE; i++)
+        loc_line_map[i / 8] |= 1 << (i % 8);
+    for (i = lo / LOC_PAGE; i <= hi / LOC_PAGE; i++)
+        loc_page_map[i / 8] |= 1 << (i % 8);
+}
+
+/*
+ * loc_payload - Add (incr 1) or remove (incr -1) a payload block from
+ *    the per-page live counts, keeping track of how many pages are live
+ */
+static void loc_payload(const char *p, int size, int incr)
+{
+    long lo, hi, i;
+
+    if (p == NULL || size <= 0)
+        return;
+    lo = p - (const char *)mem_heap_lo();
+    hi = lo + size - 1;
+    if (lo < 0 || hi >= MAX_HEAP)
+        return;
+    for (i = lo / LOC_PAGE; i <= hi / LOC_PAGE; i++) {
+        if (incr > 0 && loc_live[i]++ == 0)
+            loc_live_pages++;
+        else if (incr < 0 && --loc_live[i] == 0)
+            loc_live_pages--;
+    }
+}
+
+/* count_bits - Number of set bits in a bitmap */
+static double count_bits(const unsigned char *map, int bytes)
+{
+    double n = 0;
+    int i;
+
+    for (i = 0; i < bytes; i++)
+        n += __builtin_popcount(map[i]);
+    return n;
+}
+
+/*
+ * eval_mm_locality - Replay the trace once, untimed, and measure how the
+ *    mm package places things: the metadata footprint in lines and pages
+ *    (needs mm.c built with -DMM_LOCALITY), the mean address distance
+ *    between consecutively allocated blocks, and the number of distinct
+ *    pages holding live payload at the peak.
+ */
+static void eval_mm_locality(trace_t *trace, int tracenum, locality_t *loc)
+{
+    int i, index, size, newsize, oldsize;
+    char *p, *newp, *oldp, *last = NULL;
+    double dist = 0;
+    int nallocs = 0, peak = 0;
+
+    reinit_trace(trace);
+    memset(loc_line_map, 0, sizeof(loc_line_map));
+    memset(loc_page_map, 0, sizeof(loc_page_map));
+    memset(loc_live, 0, sizeof(loc_live));
+    loc_live_pages = 0;
+    loc_meta = 0;
+
+    mem_reset_brk();
+    loc_tracking = 1;
+    if (mm->init() < 0)
+        app_error("trace %d: mm_init failed in eval_mm_locality", tracenum);
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_alloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm->malloc(size)) == NULL)
+                app_error("trace %d: mm_malloc failed in eval_mm_locality",
+                          tracenum);
+            trace->blocks[index] = p;
+            trace->block_sizes[index] = size;
+            loc_payload(p, size, 1);
+            break;
+
+        case REALLOC: /* mm_realloc */
+            index = trace->ops[i].index;
+            newsize = trace->ops[i].size;
+            oldsize = trace->block_sizes[index];
+            oldp = trace->blocks[index];
+            if ((newp = mm->realloc(oldp, newsize)) == NULL && newsize != 0)
+                app_error("trace %d: mm_realloc failed in eval_mm_locality",
+                          tracenum);
+            loc_payload(oldp, oldsize, -1);
+            loc_payload(newp, newsize, 1);
+            trace->blocks[index] = newp;
+            trace->block_sizes[index] = newsize;
+            p = newp;
+            break;
+
+        case FREE: /* mm_free */
+            index = trace->ops[i].index;
+            if (index < 0) {
+                mm->free(NULL);
+            } else {
+                loc_payload(trace->blocks[index],
+                            trace->block_sizes[index], -1);
+                mm->free(trace->blocks[index]);
+            }
+            p = NULL;
+            break;
+
+        default:
+            app_error("trace %d: Nonexistent request type in eval_mm_locality",
+                      tracenum);
+        }
+
+        if (p != NULL) {
+            if (last != NULL)
+                dist += p > last ? p - last : last - p;
+            last = p;
+            nallocs++;
+        }
+        if (loc_live_pages > peak)
+            peak = loc_live_pages;
+    }
+    loc_tracking = 0;
+
+    loc->meta = loc_meta;
+    loc->meta_lines = count_bits(loc_line_map, sizeof(loc_line_map));
+    loc->meta_pages = count_bits(loc_page_map, sizeof(loc_page_map));
+    loc->alloc_dist = nallocs > 1 ? dist / (nallocs - 1) : 0;
+    loc->peak_pages = peak;
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -1192,6 +1706,8 @@ static void eval_libc_speed(void *ptr)
             size = trace->ops[i].size;
             if ((p = malloc(size)) == NULL)
                 unix_error("malloc failed in eval_libc_speed");
+            if (touch_payload)
+                memset(p, index, size);
             trace->blocks[index] = p;
             break;
 
@@ -1201,6 +1717,8 @@ static void eval_libc_speed(void *ptr)
             oldp = trace->blocks[index];
             if ((newp = realloc(oldp, newsize)) == NULL && newsize != 0)
                 unix_error("realloc failed in eval_libc_speed\n");
+            if (touch_payload && newp != NULL)
+                memset(newp, index, newsize);
 
             trace->blocks[index] = newp;
             break;
@@ -1218,6 +1736,300 @@ static void eval_libc_speed(void *ptr)
     }
 }
 
+/**********************************************************************
+ * The following functions implement the A/B comparison mode (-a), which
+ * interleaves timing runs of two mm packages on the same traces and
+ * reports the differences with 95% confidence intervals.
+ **********************************************************************/
+
+/* Per-trace results of an A/B comparison */
+typedef struct {
+    int valid[2];
+    double util[2];
+    double kops_mean[2], kops_sd[2];
+    double kops_delta;   /* (B - A) / A, in percent */
+    double kops_ci;      /* 95% CI half-width of kops_delta, in percent */
+    double util_delta;   /* (B - A) / A, in percent */
+    int regression;
+} ab_result_t;
+
+/*
+ * load_mm - Load an mm package from a shared object built with -DDRIVER
+ *     (e.g. "make mm.so"). Its calls to mem_sbrk and friends bind to
+ *     the copies in this executable, which is linked with -rdynamic.
+ */
+static void load_mm(const char *path, mm_ops_t *ops)
+{
+    void *handle, *sym;
+    char *name;
+
+    /* dlopen only searches the library path without a '/' */
+    if (strchr(path, '/') == NULL) {
+        if ((name = malloc(strlen(path) + 3)) == NULL)
+            unix_error("malloc failed in load_mm");
+        sprintf(name, "./%s", path);
+    } else if ((name = strdup(path)) == NULL) {
+        unix_error("strdup failed in load_mm");
+    }
+
+    if ((handle = dlopen(name, RTLD_NOW | RTLD_LOCAL)) == NULL)
+        app_error("ERROR: could not load %s: %s\n", name, dlerror());
+    ops->name = name;
+
+    /* ISO C has no cast from void * to a function pointer; copy the bits */
+#define LOAD_SYM(field, symbol) do {                                    \
+        if ((sym = dlsym(handle, symbol)) == NULL)                      \
+            app_error("ERROR: %s does not define %s\n", name, symbol);  \
+        memcpy(&ops->field, &sym, sizeof(sym));                         \
+    } while (0)
+
+    LOAD_SYM(init, "mm_init");
+    LOAD_SYM(malloc, "mm_malloc");
+    LOAD_SYM(free, "mm_free");
+    LOAD_SYM(realloc, "mm_realloc");
+    LOAD_SYM(checkheap, "mm_checkheap");
+#undef LOAD_SYM
+}
+
+/*
+ * print_json_string - Print s as a JSON string literal
+ */
+static void print_json_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(fp, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(fp, "\\u%04x", *s);
+        else
+            fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+/*
+ * print_ab_json - Write the results of an A/B comparison as JSON
+ */
+static void print_ab_json(FILE *fp, int n, stats_t *stats,
+                          ab_result_t *res, int regressions)
+{
+    int i, k;
+
+    fprintf(fp, "{\n  \"a\": ");
+    print_json_string(fp, ab_ops[0].name);
+    fprintf(fp, ",\n  \"b\": ");
+    print_json_string(fp, ab_ops[1].name);
+    fprintf(fp, ",\n  \"trials\": %d,\n  \"threshold_pct\": %g,\n",
+            ab_trials, ab_threshold);
+    fprintf(fp, "  \"regressions\": %d,\n  \"traces\": [", regressions);
+
+    for (i = 0; i < n; i++) {
+        fprintf(fp, "%s\n    {\"trace\": ", i ? "," : "");
+        print_json_string(fp, stats[i].filename);
+        fprintf(fp, ", \"ops\": %.0f", stats[i].ops);
+        for (k = 0; k < 2; k++) {
+            fprintf(fp, ", \"%c\": {\"valid\": %s", "ab"[k],
+                    res[i].valid[k] ? "true" : "false");
+            if (res[i].valid[k])
+                fprintf(fp, ", \"util\": %.6f, \"kops_mean\": %.3f, "
+                        "\"kops_sd\": %.3f", res[i].util[k],
+                        res[i].kops_mean[k], res[i].kops_sd[k]);
+            fprintf(fp, "}");
+        }
+        if (res[i].valid[0] && res[i].valid[1])
+            fprintf(fp, ", \"kops_delta_pct\": %.3f, "
+                    "\"kops_ci95_pct\": [%.3f, %.3f], "
+                    "\"util_delta_pct\": %.3f",
+                    res[i].kops_delta, res[i].kops_delta - res[i].kops_ci,
+                    res[i].kops_delta + res[i].kops_ci, res[i].util_delta);
+        fprintf(fp, ", \"regression\": %s}",
+                res[i].regression ? "true" : "false");
+    }
+    fprintf(fp, "\n  ]\n}\n");
+}
+
+/*
+ * run_compare - Check both packages for correctness on each trace, then
+ *     alternate timing runs between them (ABAB..., reversing the order
+ *     on every other trial to cancel drift) with the heap reset before
+ *     each run. Utilization is deterministic, so it is measured once.
+ *     A trace is flagged as a regression when B is slower by more than
+ *     ab_threshold percent with 95% confidence, or when B's utilization
+ *     drops by more than ab_threshold percent. Returns the number of
+ *     regressions (invalid packages count as regressions, too).
+ */
+static int run_compare(int num_tracefiles, const char *tracedir,
+                       char **tracefiles, range_t *ranges,
+                       speed_t *speed_params)
+{
+    int i, k, t, regressions = 0;
+    stats_t *stats;
+    ab_result_t *res;
+    double *kops[2];
+    trace_t *trace;
+    FILE *fp;
+
+    if ((stats = calloc(num_tracefiles, sizeof(stats_t))) == NULL ||
+        (res = calloc(num_tracefiles, sizeof(ab_result_t))) == NULL ||
+        (kops[0] = calloc(ab_trials, sizeof(double))) == NULL ||
+        (kops[1] = calloc(ab_trials, sizeof(double))) == NULL)
+        unix_error("calloc failed in run_compare");
+
+    if (verbose)
+        printf("Comparing A = %s and B = %s (%d trials, threshold %g%%)\n",
+               ab_ops[0].name, ab_ops[1].name, ab_trials, ab_threshold);
+
+    for (i = 0; i < num_tracefiles; i++) {
+        mem_init();
+        trace = read_trace(&stats[i], tracedir, tracefiles[i]);
+
+        for (k = 0; k < 2; k++) {
+            mm = &ab_ops[k];
+            res[i].valid[k] = eval_mm_valid(trace, &ranges);
+            if (res[i].valid[k])
+                res[i].util[k] = eval_mm_util(trace, i);
+        }
+
+        if (res[i].valid[0] && res[i].valid[1]) {
+            speed_params->trace = trace;
+            speed_params->ranges = ranges;
+            for (t = 0; t < ab_trials; t++) {
+                for (k = 0; k < 2; k++) {
+                    int which = (t % 2) ? 1 - k : k;
+                    mm = &ab_ops[which];
+                    kops[which][t] = stats[i].ops / 1e3 /
+                        fsecs(eval_mm_speed, speed_params);
+                }
+            }
+            for (k = 0; k < 2; k++) {
+                res[i].kops_mean[k] = stats_mean(kops[k], ab_trials);
+                res[i].kops_sd[k] = stats_stddev(kops[k], ab_trials);
+            }
+            res[i].kops_delta = 100.0 *
+                (res[i].kops_mean[1] - res[i].kops_mean[0]) /
+                res[i].kops_mean[0];
+            res[i].kops_ci = 100.0 *
+                stats_welch_ci95(kops[0], ab_trials, kops[1], ab_trials) /
+                res[i].kops_mean[0];
+            res[i].util_delta = 100.0 *
+                (res[i].util[1] - res[i].util[0]) / res[i].util[0];
+
+            res[i].regression =
+                (res[i].kops_delta + res[i].kops_ci < -ab_threshold) ||
+                (res[i].util_delta < -ab_threshold);
+        } else {
+            res[i].regression = 1;
+        }
+        regressions += res[i].regression;
+
+        free_trace(trace);
+        mem_deinit();
+    }
+    mm = &mm_linked;
+
+    if (verbose) {
+        printf("\n%7s%7s%8s%9s%9s%9s%9s  %s\n", "A util", "B util",
+               "dutil%", "A Kops", "B Kops", "dKops%", "+/-95%", "trace");
+        for (i = 0; i < num_tracefiles; i++) {
+            if (res[i].valid[0] && res[i].valid[1])
+                printf("%6.1f%%%6.1f%%%8.2f%9.0f%9.0f%9.2f%9.2f  %s%s\n",
+                       res[i].util[0] * 100, res[i].util[1] * 100,
+                       res[i].util_delta,
+                       res[i].kops_mean[0], res[i].kops_mean[1],
+                       res[i].kops_delta, res[i].kops_ci,
+                       stats[i].filename,
+                       res[i].regression ? "  REGRESSION" : "");
+            else
+                printf("%7s%7s%8s%9s%9s%9s%9s  %s  (%s invalid)\n",
+                       "-", "-", "-", "-", "-", "-", "-", stats[i].filename,
+                       res[i].valid[0] ? "B" : "A");
+        }
+        printf("\n%d regression%s above %g%%\n", regressions,
+               regressions == 1 ? "" : "s", ab_threshold);
+    }
+
+    if (ab_json) {
+        if (strcmp(ab_json, "-") == 0) {
+            print_ab_json(stdout, num_tracefiles, stats, res, regressions);
+        } else {
+            if ((fp = fopen(ab_json, "w")) == NULL)
+                unix_error("Could not open %s", ab_json);
+            print_ab_json(fp, num_tracefiles, stats, res, regressions);
+            fclose(fp);
+        }
+    }
+
+    free(kops[0]);
+    free(kops[1]);
+    free(res);
+    free(stats);
+    return regressions;
+}
+
+/*
+ * load_classes - Read a size class table (as written by mkclasses: one
+ *    upper bound in bytes per line, '#' starts a comment) and hand it
+ *    to mm.c
+ */
+static void load_classes(const char *path)
+{
+    FILE *fp;
+    char line[MAXLINE];
+    size_t max[MM_CLASSES];
+    unsigned long val;
+    int n = 0;
+
+    if (!mm_set_classes)
+        app_error("ERROR: mm.c has no mm_set_classes, can't use -S\n");
+    if ((fp = fopen(path, "r")) == NULL)
+        unix_error("Could not open class table %s", path);
+    while (fgets(line, MAXLINE, fp) != NULL) {
+        if (sscanf(line, "%lu", &val) != 1)
+            continue;
+        if (n == MM_CLASSES - 1)
+            app_error("ERROR: %s has more than %d classes\n", path,
+                      MM_CLASSES - 1);
+        max[n++] = val;
+    }
+    fclose(fp);
+
+    if (mm_set_classes(max, n) < 0)
+        app_error("ERROR: %s is not an increasing table of sizes >= 16\n",
+                  path);
+    if (verbose)
+        printf("Using %d size classes from %s\n", n, path);
+}
+
+/*
+ * count_events - Run f once more with the event counters enabled and
+ *    record the counts in stats. This is kept separate from fsecs()
+ *    so the counters see exactly one run and don't perturb the timing.
+ */
+static void count_events(void (*f)(void *), void *argp, stats_t *stats)
+{
+    int i;
+
+    perfctr_start(&perfctr);
+    f(argp);
+    perfctr_stop(&perfctr);
+
+    for (i = 0; i < PERFCTR_NEVENTS; i++)
+        stats->events[i] = perfctr.value[i];
+}
+
+/*
+ * flush_heap - Evict the simulated heap (allocator metadata and all)
+ *    from the cache before a timing sample. Unlike walking a buffer,
+ *    this leaves the trace arrays and the driver itself cached, so
+ *    only the allocator pays for the cold misses.
+ */
+static void flush_heap(void *argp __attribute__((unused)))
+{
+    if (mem_heapsize() > 0)
+        fcyc_flush(mem_heap_lo(), mem_heapsize());
+}
+
 /*************************************
  * Some miscellaneous helper routines
  ************************************/
@@ -1330,6 +2142,178 @@ static void printresults(int n, stats_t *stats)
 
 }
 
+/*
+ * printdist - prints the distribution of the timing samples behind
+ *    each result (-R): the K-best estimate that is graded, the median,
+ *    the median absolute deviation (relative to the median), and a 95%
+ *    confidence interval for the median throughput.
+ */
+static void printdist(int n, stats_t *stats)
+{
+    int i;
+    fsecs_dist_t *d;
+
+    printf("\nTiming distribution:\n");
+    printf("%5s%10s%10s%7s%9s%9s%9s  %s\n", "n", "kbest", "median",
+           "MAD%", "Kops", "lo95", "hi95", "trace");
+    for (i = 0; i < n; i++) {
+        d = &stats[i].dist;
+        if (!stats[i].valid || d->samples == 0) {
+            printf("%5s%10s%10s%7s%9s%9s%9s  %s\n", "-", "-", "-", "-",
+                   "-", "-", "-", stats[i].filename);
+            continue;
+        }
+        printf("%5d%10.6f%10.6f%7.2f%9.0f%9.0f%9.0f  %s\n", d->samples,
+               d->kbest, d->median, 100.0 * d->mad / d->median,
+               stats[i].ops / 1e3 / d->median,
+               stats[i].ops / 1e3 / d->ci_hi,
+               stats[i].ops / 1e3 / d->ci_lo, stats[i].filename);
+    }
+}
+
+/*
+ * printlocality - prints the placement locality measured with -L.
+ *    '--' marks metadata columns when mm.c wasn't built to report them.
+ */
+static void printlocality(int n, stats_t *stats)
+{
+    int i, meta = 0;
+    locality_t *loc;
+
+    printf("\nPlacement locality:\n");
+    printf("%11s%11s%12s%11s  %s\n", "meta-lines", "meta-pages",
+           "alloc-dist", "peak-pages", "trace");
+    for (i = 0; i < n; i++) {
+        loc = &stats[i].loc;
+        if (!stats[i].valid) {
+            printf("%11s%11s%12s%11s  %s\n", "-", "-", "-", "-",
+                   stats[i].filename);
+            continue;
+        }
+        if (loc->meta) {
+            meta = 1;
+            printf("%11.0f%11.0f", loc->meta_lines, loc->meta_pages);
+        } else {
+            printf("%11s%11s", "--", "--");
+        }
+        printf("%12.0f%11.0f  %s\n", loc->alloc_dist, loc->peak_pages,
+               stats[i].filename);
+    }
+    if (!meta)
+        printf("(rebuild with \"make clean; make MMFLAGS=-DMM_LOCALITY\" "
+               "for the metadata footprint)\n");
+}
+
+/*
+ * printgrowth - prints the utilization and number of mem_sbrk calls
+ *    under the selected heap growth policy, or under each with -G all
+ */
+static void printgrowth(int n, stats_t *stats)
+{
+    int i, p;
+
+    printf("\nHeap growth:\n");
+    for (p = 0; p < MM_GROW_POLICIES; p++)
+        if (growth_all || p == growth_policy)
+            printf("%16s", growth_names[p]);
+    printf("\n");
+    for (p = 0; p < MM_GROW_POLICIES; p++)
+        if (growth_all || p == growth_policy)
+            printf("%7s%9s", "util", "sbrks");
+    printf("  trace\n");
+
+    for (i = 0; i < n; i++) {
+        for (p = 0; p < MM_GROW_POLICIES; p++) {
+            if (!growth_all && p != growth_policy)
+                continue;
+            if (stats[i].valid && stats[i].growth_valid[p])
+                printf("%6.1f%%%9.0f", stats[i].growth_util[p] * 100.0,
+                       stats[i].growth_sbrks[p]);
+            else
+                printf("%7s%9s", "-", "-");
+        }
+        printf("  %s\n", stats[i].filename);
+    }
+}
+
+/*
+ * printbound - prints each trace's utilization next to the best any
+ *    non-moving allocator could do (bound) and what laying the blocks out
+ *    offline reaches (reached), so the gap worth chasing is visible
+ */
+static void printbound(int n, stats_t *stats)
+{
+    int i;
+    bound_t *b;
+
+    printf("\nUtilization bounds:\n");
+    printf("%7s%8s%12s%10s  %s\n", "util", "bound", "util/bound",
+           "reached", "trace");
+    for (i = 0; i < n; i++) {
+        b = &stats[i].bound;
+        if (!stats[i].valid || b->live <= 0) {
+            printf("%7s%8s%12s%10s  %s\n", "-", "-", "-", "-",
+                   stats[i].filename);
+            continue;
+        }
+        printf("%6.1f%%%7.1f%%%11.1f%%%9.1f%%  %s\n", stats[i].util * 100.0,
+               100.0 * b->payload / b->live,
+               100.0 * stats[i].util * b->live / b->payload,
+               100.0 * b->payload / b->placed, stats[i].filename);
+    }
+}
+
+/*
+ * printevents - prints the event counts collected with -P, normalized
+ *    per operation (task-clock in ns) except page faults. '--' marks
+ *    events the counters couldn't provide.
+ */
+static void printevents(int n, stats_t *stats)
+{
+    int i, j;
+    double *ev;
+    static const int per_op[] = {
+        PERFCTR_INSTRUCTIONS, PERFCTR_CACHE_MISSES, PERFCTR_BRANCH_MISSES,
+        PERFCTR_DTLB_MISSES, PERFCTR_TASK_CLOCK
+    };
+#define NPER_OP (int)(sizeof(per_op) / sizeof(per_op[0]))
+
+    printf("\nEvent counts per op:\n");
+    printf("%6s", "IPC");
+    for (j = 0; j < NPER_OP; j++)
+        printf("%14s", perfctr_name(per_op[j]));
+    printf("%12s  %s\n", perfctr_name(PERFCTR_PAGE_FAULTS), "trace");
+    for (i = 0; i < n; i++) {
+        if (!stats[i].valid) {
+            printf("%6s", "-");
+            for (j = 0; j < NPER_OP; j++)
+                printf("%14s", "-");
+            printf("%12s  %s\n", "-", stats[i].filename);
+            continue;
+        }
+        ev = stats[i].events;
+
+        if (ev[PERFCTR_CYCLES] > 0 && ev[PERFCTR_INSTRUCTIONS] >= 0)
+            printf("%6.2f", ev[PERFCTR_INSTRUCTIONS] / ev[PERFCTR_CYCLES]);
+        else
+            printf("%6s", "--");
+
+        for (j = 0; j < NPER_OP; j++) {
+            if (ev[per_op[j]] >= 0)
+                printf("%14.2f", ev[per_op[j]] / stats[i].ops);
+            else
+                printf("%14s", "--");
+        }
+
+        if (ev[PERFCTR_PAGE_FAULTS] >= 0)
+            printf("%12.0f", ev[PERFCTR_PAGE_FAULTS]);
+        else
+            printf("%12s", "--");
+
+        printf("  %s\n", stats[i].filename);
+    }
+}
+
 /*
  * app_error - Report an arbitrary application error
  */
@@ -1375,7 +2359,10 @@ void malloc_error(const trace_t *trace, int opnum, const char *fmt, ...)
  */
 static void usage(void)
 {
-    fprintf(stderr, "Usage: mdriver [-hlVdD] [-f <file>]\n");
+    fprintf(stderr, "Usage: mdriver [-hlVdDPRLwB] [-f <file>] [-T <method>] "
+            "[-p <cpu>] [-W <i>] [-C <method>]\n               "
+            "[-G <policy>[,<pct>]] [-S <file>|auto[,<n>]]\n               "
+            "[-a <lib.so> [-a <lib.so>] [-n <i>] [-r <pct>] [-j <file>]]\n");
     fprintf(stderr, "Options\n");
     fprintf(stderr, "\t-d <i>     Debug: 0 off; 1 default; 2 lots.\n");
     fprintf(stderr, "\t-D         Equivalent to -d2.\n");
@@ -1383,8 +2370,27 @@ static void usage(void)
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-P         Count hardware events (IPC, misses) per op.\n");
+    fprintf(stderr, "\t-T <m>     Timing method: fcyc, tsc, mono, itimer or gettod.\n");
+    fprintf(stderr, "\t-p <cpu>   Pin the driver to CPU <cpu> while timing.\n");
+    fprintf(stderr, "\t-W <i>     Run each trace <i> times untimed before timing it.\n");
+    fprintf(stderr, "\t-R         Report the timing distribution (median, MAD, 95%% CI).\n");
+    fprintf(stderr, "\t-G <p>     Heap growth policy: fixed, geometric, adaptive or all,\n");
+    fprintf(stderr, "\t           optionally \",pct\" to cap growth at pct%% of live data.\n");
+    fprintf(stderr, "\t-S <f>     Size classes for mm.c from file <f> (see mkclasses), or\n");
+    fprintf(stderr, "\t           \"auto[,n]\" to tune them from the first n mallocs (default %d).\n", CLASS_WARMUP);
+    fprintf(stderr, "\t-B         Compare utilization with offline bounds (see mmbound).\n");
+    fprintf(stderr, "\t-L         Measure placement locality (footprint, alloc distance).\n");
+    fprintf(stderr, "\t-w         Write every block after allocating it while timing.\n");
+    fprintf(stderr, "\t-C <m>     Clear the cache before each timing: walk (default), flush or none.\n");
     fprintf(stderr, "\t-V         Print diagnostics as each trace is run.\n");
     fprintf(stderr, "\t-v <i>     Set Verbosity Level to <i>\n");
     fprintf(stderr, "\t-s <s>     Timeout after s secs (default no timeout)\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-a <lib>   A/B compare: load an mm package from a shared object.\n");
+    fprintf(stderr, "\t           Given twice, compares the two; once, compares mm.c to it.\n");
+    fprintf(stderr, "\t           Exits with status 2 if any trace regressed.\n");
+    fprintf(stderr, "\t-n <i>     A/B: number of timing trials per package (default %d).\n", AB_TRIALS);
+    fprintf(stderr, "\t-r <pct>   A/B: regression threshold in percent (default %g).\n", AB_THRESHOLD);
+    fprintf(stderr, "\t-j <file>  A/B: write the results as JSON to <file> (- for stdout).\n");
 }
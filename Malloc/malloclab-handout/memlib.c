@@ -21,6 +21,7 @@
 static char *heap;
 static char *mem_brk;
 static char *mem_max_addr;
+static size_t sbrk_calls;
 
 /*
  * mem_init - initialize the memory system model
@@ -35,6 +36,7 @@ void mem_init(void){
 			0);						/* offset (dunno) */
 	mem_max_addr = heap + MAX_HEAP;
 	mem_brk = heap;					/* heap is empty initially */
+	sbrk_calls = 0;
 }
 
 /*
@@ -49,6 +51,7 @@ void mem_deinit(void){
  */
 void mem_reset_brk(){
 	mem_brk = heap;
+	sbrk_calls = 0;
 }
 
 /*
@@ -68,6 +71,7 @@ void *mem_sbrk(int incr) {
 	}
 
 	mem_brk += incr;
+	sbrk_calls++;
 	return (void *)old_brk;
 }
 
@@ -98,3 +102,11 @@ size_t mem_heapsize() {
 size_t mem_pagesize(){
 	return (size_t)getpagesize();
 }
+
+/*
+ * mem_sbrk_calls() - returns the number of successful mem_sbrk calls
+ *		since the heap was last reset
+ */
+size_t mem_sbrk_calls(){
+	return sbrk_calls;
+}
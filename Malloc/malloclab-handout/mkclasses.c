@@ -0,0 +1,107 @@
+/*
+ * mkclasses.c - Generate a size class table for mm.c from traces.
+ *
+ * Reads the allocation requests of one or more .rep traces, converts
+ * each to the block size mm.c would use for it, and builds the table
+ * with mm.c's own warm-up tuning (mm_tune_classes): powers of two up to
+ * the largest size requested, with the levels that leaves over given to
+ * popular sizes (2040 and 4072 in amptjp.rep, say), one level each.
+ * The table is written to stdout in the format "mdriver -S <file>"
+ * reads: one inclusive upper bound in bytes per line.
+ *
+ * usage: mkclasses [-w <allocs>] <trace>...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mm.h"
+
+#define MAXLINE   1024
+
+static unsigned long hist[MM_HIST_BINS + 1]; /* last bin: all larger */
+static unsigned long total;
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: mkclasses [-w <allocs>] <trace>...\n");
+    fprintf(stderr, "\t-w <i>  Only use the first <i> allocations of each trace.\n");
+}
+
+/*
+ * read_trace - Add the alloc and realloc requests of a .rep trace to the
+ *     histogram, stopping after limit of them if limit > 0
+ */
+static void read_trace(const char *path, long limit)
+{
+    FILE *fp;
+    char line[MAXLINE];
+    char type;
+    int index, size, header = 4;
+    long n = 0;
+    size_t asize;
+
+    if ((fp = fopen(path, "r")) == NULL) {
+        perror(path);
+        exit(1);
+    }
+    while (fgets(line, MAXLINE, fp) != NULL) {
+        if (header > 0) {       /* weight, ids, ops, ignore_ranges */
+            header--;
+            continue;
+        }
+        if (sscanf(line, " %c %d %d", &type, &index, &size) != 3)
+            continue;
+        if ((type != 'a' && type != 'r') || size <= 0)
+            continue;
+        if (limit > 0 && n++ >= limit)
+            break;
+        asize = mm_block_size(size) / 8;
+        hist[asize < MM_HIST_BINS ? asize : MM_HIST_BINS]++;
+        total++;
+    }
+    fclose(fp);
+}
+
+int main(int argc, char **argv)
+{
+    int c, i, n;
+    long limit = 0;
+    size_t bounds[MM_CLASSES];
+
+    while ((c = getopt(argc, argv, "w:h")) != EOF) {
+        switch (c) {
+        case 'w':
+            limit = atol(optarg);
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (optind == argc) {
+        usage();
+        exit(1);
+    }
+
+    for (i = optind; i < argc; i++)
+        read_trace(argv[i], limit);
+    if (total == 0) {
+        fprintf(stderr, "mkclasses: no allocations found\n");
+        exit(1);
+    }
+    n = mm_tune_classes(hist, total, bounds);
+
+    /* The last level is left unbounded for mm.c to fill in */
+    printf("# %d size classes from %lu allocations in", MM_CLASSES, total);
+    for (i = optind; i < argc; i++)
+        printf(" %s", argv[i]);
+    printf("\n");
+    for (i = 0; i < n; i++)
+        printf("%lu\n", (unsigned long)bounds[i]);
+    return 0;
+}
@@ -60,6 +60,20 @@
 #define checkheap(...)
 #endif
 
+/*
+ *  Locality hook
+ *  -------------
+ *  - meta_touch reports an access to the allocator's own metadata to
+ *    the driver, for the footprint numbers of mdriver -L. It compiles
+ *    away unless built with "make MMFLAGS=-DMM_LOCALITY".
+ */
+
+#ifdef MM_LOCALITY
+#define meta_touch(p, len) mm_meta_touch((p), (len))
+#else
+#define meta_touch(p, len)
+#endif
+
 /*
  *  Helper functions
  *  ----------------
@@ -72,8 +86,13 @@
 #define WSIZE       8       /* Word and header/footer size (bytes) */
 #define DSIZE       16       /* Doubleword size (bytes) */
 #define CHUNKSIZE  (1<<12)  /* Extend heap by this amount (bytes) */
-#define SEGLEVEL    16	    /* 16 groups for different sizes */
+#define SEGLEVEL    MM_CLASSES /* 16 groups for different sizes */
+#define GROW_PCT    25      /* default cap on growth: % of live data */
+#define UTIL_RISK   75      /* adaptive: no doubling below this util % */
+#define GROW_STEP   128     /* adaptive: least rounding of an extension */
+#define RAMP_RUNS   3       /* adaptive: ramp-up extensions before doubling */
 #define MAX(x, y) ((x) > (y)? (x) : (y))
+#define MIN(x, y) ((x) < (y)? (x) : (y))
 /* alignment */
 #define ALIGNMENT   8
 #define ALIGN(p) (((size_t)(p) + (ALIGNMENT-1)) & ~0x7)
@@ -82,10 +101,52 @@
 #define SUPER_PACK(size, prev_free, alloc)  ((size) | (prev_free) | (alloc)) 
 
 
+/*
+ *  Hot-path counters
+ *  -----------------
+ *  - mm_stat(x) does x only when built with "make MMFLAGS=-DMM_STATS";
+ *    mdriver then dumps the counters for each trace after its
+ *    utilization run. Otherwise they compile away entirely.
+ */
+
+#ifdef MM_STATS
+#define SCAN_BUCKETS 12     /* find_fit scan lengths 0, 1, 2-3, ..., 1024+ */
+static struct {
+    unsigned long fits;                     /* find_fit calls */
+    unsigned long misses;                   /* ... that found nothing */
+    unsigned long searches[SEGLEVEL];       /* lists searched per level */
+    unsigned long scanned[SEGLEVEL];        /* blocks examined per level */
+    unsigned long scan_hist[SCAN_BUCKETS];  /* blocks examined per call */
+    unsigned long coalesce[4];              /* cases 1-4 of coalesce */
+    unsigned long splits, exact;            /* place with/without a split */
+    unsigned long extends, extend_bytes;    /* extend_heap calls, bytes */
+    unsigned long reallocs, realloc_bytes;  /* realloc calls, bytes copied */
+} mm_stats;
+#define mm_stat(x) (x)
+#else
+#define mm_stat(x)
+#endif
+
+
 static char *heap_listp = 0;  /* Pointer to first block */
 static char *heap_endp  = NULL; /* Pointer to last free block in heap */
 static char *free_table = NULL;  /* Pointer to free table */
 
+/* Size classes: free blocks of up to class_max[i] bytes go in level i */
+static size_t class_max[SEGLEVEL];
+static int class_custom = 0;     /* table set with mm_set_classes */
+static int class_warmup = 0;     /* mallocs to sample before tuning, or 0 */
+static int class_seen;           /* mallocs sampled so far */
+static unsigned long class_hist[MM_HIST_BINS + 1]; /* last: all larger */
+
+/* Heap growth policy (see grow_size) */
+static int grow_policy = MM_GROW_FIXED;
+static int grow_pct = GROW_PCT;
+static size_t last_grow;         /* bytes added by the last extension */
+static size_t live_bytes;        /* bytes in allocated blocks */
+static size_t live_at_grow;      /* live_bytes at the last extension */
+static int ramp_runs;            /* extensions in a row live data outgrew */
+
 
 // Align p to a multiple of w bytes
 static inline void* align(const void const* p, unsigned char w) {
@@ -119,11 +180,13 @@ static inline unsigned get(const void *p) {
      * ------------------------------------
      * read a word at address p 
      */
+    meta_touch(p, 4);
     return (*(unsigned *)(p));
 }
 
 static inline void put(void *p, unsigned val) {
     // #define PUT(p, val)  (*(unsigned int *)(p) = (val))
+    meta_touch(p, 4);
     *(unsigned *)(p) = val;
 }
       
@@ -218,20 +281,20 @@ static inline void set_size(void * block, size_t size) {
 }
 
 static inline int get_level(size_t size) {
-    int r = 0, s = 16;
-    while ((int)size > s-1 && r < SEGLEVEL) {
-        s = s << 1; // double the size
+    int r = 0;
+    while (r < SEGLEVEL-1 && size > class_max[r])
         r++;
-    }
-    return r - 1;
+    return r;
 }
 
 // get the head of free list
 static inline char **get_head(int level) {
+    meta_touch(free_table + (level * DSIZE), WSIZE);
     return (char **)(free_table + (level * DSIZE));
 }
 // get the end of free list
 static inline char **get_end(int level) {
+    meta_touch(free_table + (level * DSIZE) + WSIZE, WSIZE);
     return (char **)(free_table + (level * DSIZE) + WSIZE);    
 }
 
@@ -273,9 +336,16 @@ static inline uint32_t* block_mem(uint32_t* const block) {
 
 /* Function prototypes for internal helper routines */
 static void *extend_heap(size_t words);
+static size_t grow_size(size_t need);
+static void default_classes(void);
+static void tune_classes(void);
+static void rebuild_free_lists(void);
 static void place(void *bp, size_t asize);
 static void *find_fit(size_t asize);
 static void *coalesce(void *bp);
+#ifdef MM_STATS
+static void count_scan(unsigned long n);
+#endif
 
 static void checkfreetable();
 static void blockdetails(void *bp);
@@ -310,6 +380,14 @@ int mm_init(void) {
     
     heap_listp += (offset + 4);
     
+    live_bytes = live_at_grow = 0;
+    last_grow = CHUNKSIZE;
+    ramp_runs = 0;
+    
+    if (!class_custom)
+        default_classes();
+    class_seen = 0;
+    memset(class_hist, 0, sizeof(class_hist));
     if (extend_heap(CHUNKSIZE/WSIZE) == NULL)
         return -1;
     return 0;
@@ -334,11 +412,17 @@ void *malloc (size_t size) {
     if (size == 0)
         return NULL;
     
-    asize = ALIGN(size + 4); /* header = 4 byte */
-    
     /* Adjust block size to include overhead and alignment reqs. */
-    if (asize < 16)
-        asize = 16;
+    asize = mm_block_size(size);
+    
+    /* Sample sizes for the class table during the warm-up window */
+    if (class_seen < class_warmup) {
+        class_hist[MIN(asize / ALIGNMENT, MM_HIST_BINS)]++;
+        if (++class_seen == class_warmup) {
+            tune_classes();
+            rebuild_free_lists();
+        }
+    }
     
     /* Search the free list for a fit */
     if ((bp = find_fit(asize)) != NULL) {
@@ -362,11 +446,8 @@ void *malloc (size_t size) {
         available = block_size(block_header(heap_endp)); // get left space if available...
     }
     
-    if (asize-available > CHUNKSIZE) {
-        extendsize = asize-available; // use available size to reduce external fragmentation 
-    } else {
-        extendsize = CHUNKSIZE;
-    }
+    // use available size to reduce external fragmentation 
+    extendsize = grow_size(asize-available);
     
     if ((bp = extend_heap(extendsize/WSIZE)) == NULL)
         return NULL;
@@ -386,14 +467,15 @@ void free (void *ptr) {
         mm_init();
     }
     
+    live_bytes -= block_size(block_header(ptr));
     set_free(block_header(ptr));
     put(block_footer(ptr), get(block_header(ptr))); // make footer consist with header
     coalesce(ptr);
 }
 
 static void insert_node(int level, void *bp) {
-    char **group_head = (char **)(free_table + (level * DSIZE));
-    char **group_end = (char **)(free_table + (level * DSIZE) + WSIZE);
+    char **group_head = get_head(level);
+    char **group_end = get_end(level);
     
     if (*group_head == NULL) {
         // empty list
@@ -459,6 +541,8 @@ static void *coalesce(void *bp)
     size_t next_alloc = block_alloc(block_header(block_next(bp)));
     size_t size = block_size(block_header(bp));
     
+    mm_stat(mm_stats.coalesce[(!prev_alloc << 1) | !next_alloc]++);
+
     if (prev_alloc && next_alloc) {            /* Case 1 0 1 */
         //return bp;
     }
@@ -545,6 +629,8 @@ void *realloc(void *oldptr, size_t size) {
     if(size < oldsize) 
         oldsize = size;
     memcpy(newptr, oldptr, oldsize);
+    mm_stat(mm_stats.reallocs++);
+    mm_stat(mm_stats.realloc_bytes += oldsize);
     
     /* Free the old block. */
     free(oldptr);
@@ -702,6 +788,8 @@ static void *extend_heap(size_t words)
     size = (words % 2) ? (words+1) * WSIZE : words * WSIZE;
     if ((long)(bp = mem_sbrk(size)) == -1)
         return NULL;
+    mm_stat(mm_stats.extends++);
+    mm_stat(mm_stats.extend_bytes += size);
     
     /* Initialize free block header/footer and the epilogue header */
     int prev_alloc = !!(get(block_header(bp)) & 0x02) << 1;   // 8-byte alignment 
@@ -718,6 +806,218 @@ static void *extend_heap(size_t words)
     return coalesce(bp);
 }
 
+/*
+ * grow_size - How many bytes to extend the heap by when need bytes are
+ *     missing, under the current growth policy:
+ *   fixed:     CHUNKSIZE, or exactly need if that is larger.
+ *   geometric: double the last extension, capped at grow_pct% of the
+ *              live data so a big heap doesn't over-reserve.
+ *   adaptive:  need, rounded up to a step of GROW_STEP that doubles
+ *              with need (to about 1/32 of it, at most CHUNKSIZE), so a
+ *              heap that isn't growing isn't padded but a big block
+ *              freed and reused has a little slack. Only once live data
+ *              has outgrown RAMP_RUNS extensions in a row (a sustained
+ *              ramp-up), with utilization at least UTIL_RISK%, double
+ *              the last extension, with the same cap.
+ */
+static size_t grow_size(size_t need)
+{
+    size_t grow, cap, step;
+    size_t heapsize = mem_heapsize();
+
+    if (grow_policy == MM_GROW_FIXED)
+        return MAX(need, CHUNKSIZE);
+
+    if (grow_policy == MM_GROW_ADAPTIVE) {
+        if (live_bytes > live_at_grow &&
+            live_bytes - live_at_grow >= last_grow)
+            ramp_runs++;
+        else
+            ramp_runs = 0;
+        live_at_grow = live_bytes;
+        if (ramp_runs < RAMP_RUNS ||
+            live_bytes * 100 < heapsize * UTIL_RISK) {
+            for (step = GROW_STEP; step < CHUNKSIZE && step * 32 <= need;
+                 step *= 2)
+                ;
+            last_grow = (need + step - 1) / step * step;
+            return last_grow;
+        }
+        grow = MIN(last_grow * 2, live_bytes / 100 * grow_pct);
+    } else {
+        cap = MAX(live_bytes / 100 * grow_pct, CHUNKSIZE);
+        grow = MAX(MIN(last_grow * 2, cap), CHUNKSIZE);
+        live_at_grow = live_bytes;
+    }
+    last_grow = grow;
+    return MAX(need, grow);
+}
+
+/*
+ * mm_set_growth - Select the heap growth policy, and for the geometric
+ *     and adaptive policies the cap as a percentage of live data
+ *     (pct <= 0 keeps the default)
+ */
+void mm_set_growth(int policy, int pct)
+{
+    grow_policy = policy;
+    grow_pct = pct > 0 ? pct : GROW_PCT;
+}
+
+/*
+ * default_classes - Powers of two: 16-31, 32-63, ..., 2^19 and up
+ */
+static void default_classes(void)
+{
+    int i;
+    for (i = 0; i < SEGLEVEL-1; i++)
+        class_max[i] = ((size_t)32 << i) - 1;
+    class_max[SEGLEVEL-1] = (size_t)-1;
+}
+
+/*
+ * fill_classes - Complete a table whose first n bounds are set: the
+ *     rest double from there, and the last level takes everything
+ */
+static void fill_classes(int n)
+{
+    for (; n < SEGLEVEL-1; n++)
+        class_max[n] = n ? class_max[n-1] * 2 + 1 : 31;
+    class_max[SEGLEVEL-1] = (size_t)-1;
+}
+
+/*
+ * add_class - Add bound to the n bounds in max, kept sorted, unless it
+ *     is there already. Returns the new count.
+ */
+static int add_class(size_t *max, int n, size_t bound)
+{
+    int i = n;
+    while (i > 0 && max[i-1] > bound)
+        i--;
+    if (i > 0 && max[i-1] == bound)
+        return n;
+    memmove(max + i + 1, max + i, (n - i) * sizeof(*max));
+    max[i] = bound;
+    return n + 1;
+}
+
+/*
+ * mm_block_size - The block mm_malloc uses for a request of size bytes:
+ *     a 4-byte header, aligned, and at least 16 bytes
+ */
+size_t mm_block_size(size_t size)
+{
+    size_t asize = ALIGN(size + 4);
+    return asize < 16 ? 16 : asize;
+}
+
+/*
+ * mm_tune_classes - Build a class table from a histogram of total block
+ *     sizes: powers of two up to the largest size, and the levels that
+ *     frees up above it go to popular sizes (at least 1/SEGLEVEL of the
+ *     requests), most popular first, each in a level of its own. Writes
+ *     the bounds to max and returns how many; clears the bins it used.
+ */
+int mm_tune_classes(unsigned long *hist, unsigned long total, size_t *max)
+{
+    size_t big, size;
+    unsigned long top;
+    int i, bin, best, n = 0;
+
+    for (bin = MM_HIST_BINS; bin > 0 && hist[bin] == 0; bin--)
+        ;
+    big = bin == MM_HIST_BINS ? (size_t)-1 : (size_t)bin * ALIGNMENT;
+    for (i = 0; i < SEGLEVEL-1; i++) {
+        max[n++] = ((size_t)32 << i) - 1;
+        if (max[n-1] >= big)
+            break;
+    }
+
+    while (n < SEGLEVEL-1) {
+        top = 0;
+        best = 0;
+        for (bin = 0; bin < MM_HIST_BINS; bin++) {
+            if (hist[bin] > top) {
+                top = hist[bin];
+                best = bin;
+            }
+        }
+        if (top == 0 || top * SEGLEVEL < total)
+            break;
+        hist[best] = 0;
+        size = (size_t)best * ALIGNMENT;
+        if (n + 2 > SEGLEVEL-1)
+            break;
+        if (size - ALIGNMENT >= 16)
+            n = add_class(max, n, size - ALIGNMENT);
+        n = add_class(max, n, size);
+    }
+    return n;
+}
+
+/*
+ * tune_classes - Rebuild the class table from the warm-up histogram
+ */
+static void tune_classes(void)
+{
+    size_t max[SEGLEVEL];
+    int i, n = mm_tune_classes(class_hist, class_seen, max);
+
+    for (i = 0; i < n; i++)
+        class_max[i] = max[i];
+    fill_classes(n);
+}
+
+/*
+ * rebuild_free_lists - Put every free block back in the list for its
+ *     level under the current class table
+ */
+static void rebuild_free_lists(void)
+{
+    char *bp;
+
+    memset(free_table, 0, SEGLEVEL*DSIZE);
+    for (bp = block_next(heap_listp); block_size(block_header(bp)) > 0;
+         bp = block_next(bp)) {
+        if (!block_alloc(block_header(bp)))
+            insert_node(get_level(block_size(block_header(bp))), bp);
+    }
+}
+
+/*
+ * mm_set_classes - Use the n increasing class bounds in max (bytes,
+ *     inclusive) for the lowest levels, doubling above them. n = 0
+ *     goes back to powers of two. Returns -1 if the table is unusable.
+ */
+int mm_set_classes(const size_t *max, int n)
+{
+    int i;
+
+    if (n < 0 || n > SEGLEVEL-1)
+        return -1;
+    for (i = 0; i < n; i++)
+        if (max[i] < 16 || (i > 0 && max[i] <= max[i-1]))
+            return -1;
+    for (i = 0; i < n; i++)
+        class_max[i] = max[i];
+    if (n > 0)
+        fill_classes(n);
+    else
+        default_classes();
+    class_custom = (n > 0);
+    return 0;
+}
+
+/*
+ * mm_set_class_warmup - Histogram the first mallocs after each mm_init
+ *     and then retune the class table from them (0 turns this off)
+ */
+void mm_set_class_warmup(int mallocs)
+{
+    class_warmup = mallocs > 0 ? mallocs : 0;
+}
+
 static void place(void *bp, size_t asize)
 /* $end mmplace-proto */
 {
@@ -725,6 +1025,8 @@ static void place(void *bp, size_t asize)
     
     if ((csize - asize) >= 16) { // min. requirement
         int c = (bp == heap_endp);
+        mm_stat(mm_stats.splits++);
+        live_bytes += asize;
     	
         delete_node(get_level(block_size(block_header(bp))), bp);
     	
@@ -742,6 +1044,8 @@ static void place(void *bp, size_t asize)
         }
     }
     else {
+        mm_stat(mm_stats.exact++);
+        live_bytes += csize;
         delete_node(get_level(block_size(block_header(bp))), bp);
         set_aloc(block_header(bp));
         set_prev_aloc_flag(block_header(block_next(bp)));
@@ -753,18 +1057,90 @@ static void *find_fit(size_t asize)
     // first fit
     void *bp;
     char *group_head;
+#ifdef MM_STATS
+    unsigned long scanned = 0;
+#endif
     
     int level = get_level(asize);
 
+    mm_stat(mm_stats.fits++);
     while (level < SEGLEVEL) { // serach in the size-class from small to large
         group_head = *(get_head(level));
+        mm_stat(mm_stats.searches[level]++);
         for (bp = group_head; bp && block_size(block_header(bp)) > 0; bp = next_free(bp)) {
+            mm_stat(mm_stats.scanned[level]++);
+            mm_stat(scanned++);
             if (!block_alloc(block_header(bp)) && asize <= block_size(block_header(bp))) {
+                mm_stat(count_scan(scanned));
                 return bp;
             }
         }
         level++;
     }
     
+    mm_stat(mm_stats.misses++);
+    mm_stat(count_scan(scanned));
     return NULL; /* No fit */
 }
+
+#ifdef MM_STATS
+/* Add one find_fit scan of n blocks to the histogram */
+static void count_scan(unsigned long n)
+{
+    int b = 0;
+    while (n > 0 && b < SCAN_BUCKETS - 1) {
+        n >>= 1;
+        b++;
+    }
+    mm_stats.scan_hist[b]++;
+}
+
+/*
+ * mm_stats_reset - Zero all the hot-path counters
+ */
+void mm_stats_reset(void)
+{
+    memset(&mm_stats, 0, sizeof(mm_stats));
+}
+
+/*
+ * mm_stats_dump - Print the hot-path counters since the last reset
+ */
+void mm_stats_dump(FILE *fp)
+{
+    int i;
+
+    fprintf(fp, "  find_fit: %lu calls, %lu without a fit\n",
+            mm_stats.fits, mm_stats.misses);
+    fprintf(fp, "  %5s %10s %12s %8s\n", "level", "searches", "scanned", "avg");
+    for (i = 0; i < SEGLEVEL; i++) {
+        if (mm_stats.searches[i] == 0)
+            continue;
+        fprintf(fp, "  %5d %10lu %12lu %8.2f\n", i, mm_stats.searches[i],
+                mm_stats.scanned[i],
+                (double)mm_stats.scanned[i] / mm_stats.searches[i]);
+    }
+    fprintf(fp, "  scan length:");
+    for (i = 0; i < SCAN_BUCKETS; i++) {
+        if (mm_stats.scan_hist[i] == 0)
+            continue;
+        if (i <= 1)
+            fprintf(fp, " %d:%lu", i, mm_stats.scan_hist[i]);
+        else if (i == SCAN_BUCKETS - 1)
+            fprintf(fp, " %d+:%lu", 1 << (i - 1), mm_stats.scan_hist[i]);
+        else
+            fprintf(fp, " %d-%d:%lu", 1 << (i - 1), (1 << i) - 1,
+                    mm_stats.scan_hist[i]);
+    }
+    fprintf(fp, "\n");
+    fprintf(fp, "  coalesce: %lu none, %lu next, %lu prev, %lu both\n",
+            mm_stats.coalesce[0], mm_stats.coalesce[1],
+            mm_stats.coalesce[2], mm_stats.coalesce[3]);
+    fprintf(fp, "  place: %lu splits, %lu exact fits\n",
+            mm_stats.splits, mm_stats.exact);
+    fprintf(fp, "  extend_heap: %lu calls, %lu bytes\n",
+            mm_stats.extends, mm_stats.extend_bytes);
+    fprintf(fp, "  realloc: %lu calls, %lu bytes copied\n",
+            mm_stats.reallocs, mm_stats.realloc_bytes);
+}
+#endif
@@ -23,3 +23,43 @@ extern int mm_init(void);
 /* This is largely for debugging.  You can do what you want with the
    verbose flag; we don't care. */
 extern int mm_checkheap(int verbose);
+
+/* Reports a metadata access to the driver when mm.c is built with
+   -DMM_LOCALITY (see mdriver -L); mdriver provides the definition. */
+extern void mm_meta_touch(const void *p, size_t len);
+
+/* Hot-path counters, only defined when mm.c is built with -DMM_STATS
+   (weak, so the driver can check for them and other packages link) */
+extern void mm_stats_reset(void) __attribute__((weak));
+extern void mm_stats_dump(FILE *fp) __attribute__((weak));
+
+/* Heap growth policies for mm_set_growth (see grow_size in mm.c) */
+#define MM_GROW_FIXED     0   /* CHUNKSIZE, or exactly what's missing */
+#define MM_GROW_GEOMETRIC 1   /* double each time, up to pct% of live data */
+#define MM_GROW_ADAPTIVE  2   /* follow the allocation rate; exact fits
+                                 when utilization is at risk */
+#define MM_GROW_POLICIES  3
+
+/* Select the heap growth policy for all later heap extensions.
+   Weak so the driver can tell whether the package supports it. */
+extern void mm_set_growth(int policy, int pct) __attribute__((weak));
+
+/* Size classes of the segregated free lists. mm_set_classes takes up
+   to MM_CLASSES-1 increasing upper bounds in bytes (n = 0 restores
+   powers of two) and returns -1 if it can't use them;
+   mm_set_class_warmup retunes the table from the first mallocs after
+   each mm_init. Weak, like mm_set_growth. */
+#define MM_CLASSES 16
+extern int mm_set_classes(const size_t *max, int n) __attribute__((weak));
+extern void mm_set_class_warmup(int mallocs) __attribute__((weak));
+
+/* The tuning behind mm_set_class_warmup, for tools such as mkclasses
+   that build a table offline the same way. mm_block_size is the block
+   mm_malloc uses for a request. mm_tune_classes takes a histogram of
+   block sizes, one bin per 8 bytes up to MM_HIST_BINS (the last bin
+   counts all larger ones), from total requests; it writes up to
+   MM_CLASSES-1 bounds to max and returns how many. */
+#define MM_HIST_BINS 1024
+extern size_t mm_block_size(size_t size);
+extern int mm_tune_classes(unsigned long *hist, unsigned long total,
+                           size_t *max);
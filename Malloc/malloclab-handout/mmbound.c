@@ -0,0 +1,133 @@
+/*
+ * mmbound.c - Print utilization bounds for malloc traces.
+ *
+ * For each .rep trace: the peak live payload, the peak of the padded
+ * live blocks (no non-moving allocator can do with a smaller heap),
+ * and the smallest heap of the offline layouts bound.c tries. The best
+ * utilization possible lies between the last two columns.
+ *
+ * usage: mmbound [-H <header>] [-a <align>] [-m <minblock>] <trace>...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bound.h"
+
+#define MAXLINE 1024
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: mmbound [-H <header>] [-a <align>] [-m <minblock>] <trace>...\n");
+    fprintf(stderr, "\t-H <n>  Per-block header bytes (default %d).\n", BOUND_HEADER);
+    fprintf(stderr, "\t-a <n>  Block alignment (default %d).\n", BOUND_ALIGN);
+    fprintf(stderr, "\t-m <n>  Minimum block size (default %d).\n", BOUND_MINBLOCK);
+}
+
+/*
+ * read_rep - Read the requests of a .rep trace into a new array.
+ *     Returns the number of requests, with the number of block ids
+ *     in *nids.
+ */
+static int read_rep(const char *path, bound_op_t **opsp, int *nids)
+{
+    FILE *fp;
+    char type[MAXLINE];
+    int weight, num_ops, ignore, index, size, n = 0;
+    bound_op_t *ops;
+
+    if ((fp = fopen(path, "r")) == NULL) {
+        perror(path);
+        exit(1);
+    }
+    if (fscanf(fp, "%d %d %d %d", &weight, nids, &num_ops, &ignore) != 4 ||
+        num_ops < 0) {
+        fprintf(stderr, "mmbound: %s: bad trace header\n", path);
+        exit(1);
+    }
+    if ((ops = malloc((num_ops ? num_ops : 1) * sizeof(bound_op_t))) == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+
+    while (n < num_ops && fscanf(fp, "%s", type) == 1) {
+        switch (type[0]) {
+        case 'a':
+        case 'r':
+            if (fscanf(fp, "%d", &index) != 1)
+                goto bad;
+            /* like mdriver, a missing size repeats the last one */
+            if (fscanf(fp, "%d", &size) != 1 && n == 0)
+                goto bad;
+            ops[n].type = type[0] == 'a' ? BOUND_ALLOC : BOUND_REALLOC;
+            ops[n].index = index;
+            ops[n].size = size;
+            break;
+        case 'f':
+            if (fscanf(fp, "%d", &index) != 1)
+                goto bad;
+            ops[n].type = BOUND_FREE;
+            ops[n].index = index;
+            ops[n].size = 0;
+            break;
+        default:
+            goto bad;
+        }
+        n++;
+    }
+    fclose(fp);
+    *opsp = ops;
+    return n;
+
+bad:
+    fprintf(stderr, "mmbound: %s: bad request %d\n", path, n + 1);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    bound_params_t params;
+    bound_op_t *ops;
+    bound_t b;
+    int c, i, n, nids;
+
+    bound_default_params(&params);
+    while ((c = getopt(argc, argv, "H:a:m:h")) != EOF) {
+        switch (c) {
+        case 'H':
+            params.header = atoi(optarg);
+            break;
+        case 'a':
+            params.align = atoi(optarg);
+            break;
+        case 'm':
+            params.minblock = atoi(optarg);
+            break;
+        case 'h':
+            usage();
+            exit(0);
+        default:
+            usage();
+            exit(1);
+        }
+    }
+    if (optind == argc || params.align == 0) {
+        usage();
+        exit(1);
+    }
+
+    printf("%11s%11s%11s%8s%8s  %s\n", "payload", "live", "placed",
+           "bound", "reached", "trace");
+    for (i = optind; i < argc; i++) {
+        n = read_rep(argv[i], &ops, &nids);
+        if (bound_trace(ops, n, nids, &params, &b) < 0) {
+            fprintf(stderr, "mmbound: out of memory\n");
+            exit(1);
+        }
+        printf("%11.0f%11.0f%11.0f%7.1f%%%7.1f%%  %s\n", b.payload, b.live,
+               b.placed, b.live > 0 ? 100.0 * b.payload / b.live : 0,
+               b.placed > 0 ? 100.0 * b.payload / b.placed : 0, argv[i]);
+        free(ops);
+    }
+    return 0;
+}
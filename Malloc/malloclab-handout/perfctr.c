@@ -0,0 +1,154 @@
+/*
+ * perfctr.c - Count hardware and software events around a region of
+ *     code using the Linux perf_event_open(2) interface.
+ *
+ * Each event is opened as an independent, initially disabled counter
+ * on the calling thread, user space only. If the kernel has to
+ * multiplex the hardware counters, the raw counts are scaled by
+ * time_enabled/time_running, just like perf stat does.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perfctr.h"
+
+static const char *names[PERFCTR_NEVENTS] = {
+    "cycles", "instructions", "cache-misses", "branch-misses",
+    "dTLB-misses", "task-clock", "page-faults"
+};
+
+const char *perfctr_name(int event)
+{
+    if (event < 0 || event >= PERFCTR_NEVENTS)
+        return "?";
+    return names[event];
+}
+
+#ifdef __linux__
+
+/* (type, config) of each event, in the same order as the enum */
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} events[PERFCTR_NEVENTS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+static int open_event(int i)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+        PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    /* pid = 0, cpu = -1: this thread, on whatever CPU it runs */
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int perfctr_open(perfctr_t *pc)
+{
+    int i, n = 0;
+
+    pc->nhw = 0;
+    for (i = 0; i < PERFCTR_NEVENTS; i++) {
+        pc->fd[i] = open_event(i);
+        pc->value[i] = -1;
+        if (pc->fd[i] >= 0) {
+            n++;
+            if (events[i].type != PERF_TYPE_SOFTWARE)
+                pc->nhw++;
+        }
+    }
+    return n;
+}
+
+void perfctr_start(perfctr_t *pc)
+{
+    int i;
+
+    for (i = 0; i < PERFCTR_NEVENTS; i++) {
+        if (pc->fd[i] >= 0) {
+            ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void perfctr_stop(perfctr_t *pc)
+{
+    int i;
+    uint64_t buf[3]; /* value, time_enabled, time_running */
+
+    for (i = 0; i < PERFCTR_NEVENTS; i++)
+        if (pc->fd[i] >= 0)
+            ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+    for (i = 0; i < PERFCTR_NEVENTS; i++) {
+        pc->value[i] = -1;
+        if (pc->fd[i] < 0)
+            continue;
+        if (read(pc->fd[i], buf, sizeof(buf)) != sizeof(buf))
+            continue;
+        if (buf[2] == 0)        /* never got scheduled on a counter */
+            continue;
+        pc->value[i] = (double)buf[0] * ((double)buf[1] / (double)buf[2]);
+    }
+}
+
+void perfctr_close(perfctr_t *pc)
+{
+    int i;
+
+    for (i = 0; i < PERFCTR_NEVENTS; i++) {
+        if (pc->fd[i] >= 0)
+            close(pc->fd[i]);
+        pc->fd[i] = -1;
+    }
+}
+
+#else /* !__linux__ */
+
+/* No perf_event_open here; every event reads as unavailable */
+
+int perfctr_open(perfctr_t *pc)
+{
+    int i;
+
+    pc->nhw = 0;
+    for (i = 0; i < PERFCTR_NEVENTS; i++) {
+        pc->fd[i] = -1;
+        pc->value[i] = -1;
+    }
+    return 0;
+}
+
+void perfctr_start(perfctr_t *pc __attribute__((unused))) {}
+
+void perfctr_stop(perfctr_t *pc __attribute__((unused))) {}
+
+void perfctr_close(perfctr_t *pc __attribute__((unused))) {}
+
+#endif /* __linux__ */
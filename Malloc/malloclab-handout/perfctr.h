@@ -0,0 +1,54 @@
+/*
+ * perfctr.h - Count hardware and software events around a region of
+ *     code using the Linux perf_event_open(2) interface.
+ *
+ * The package has no dependencies on the malloc driver, so it can be
+ * compiled into any other benchmark (e.g. the cache lab or proxy lab
+ * tools) by copying perfctr.c and perfctr.h.
+ */
+#ifndef __PERFCTR_H_
+#define __PERFCTR_H_
+
+/* The events we know how to count */
+enum {
+    PERFCTR_CYCLES,         /* hardware: CPU cycles */
+    PERFCTR_INSTRUCTIONS,   /* hardware: retired instructions */
+    PERFCTR_CACHE_MISSES,   /* hardware: last-level cache misses */
+    PERFCTR_BRANCH_MISSES,  /* hardware: mispredicted branches */
+    PERFCTR_DTLB_MISSES,    /* hardware: data TLB read misses */
+    PERFCTR_TASK_CLOCK,     /* software: task clock (ns) */
+    PERFCTR_PAGE_FAULTS,    /* software: page faults */
+    PERFCTR_NEVENTS
+};
+
+typedef struct {
+    int fd[PERFCTR_NEVENTS];        /* -1 if the event could not be opened */
+    double value[PERFCTR_NEVENTS];  /* counts from the last perfctr_stop,
+                                       or -1 if the event is unavailable */
+    int nhw;                        /* number of hardware events opened */
+} perfctr_t;
+
+/*
+ * perfctr_open - Open all the counters we are permitted to use.
+ *     Hardware events are skipped (and software events used alone)
+ *     when perf_event_paranoid or the platform doesn't allow them.
+ *     Returns the number of events opened; 0 means none at all.
+ */
+int perfctr_open(perfctr_t *pc);
+
+/* perfctr_start - Reset and enable every open counter */
+void perfctr_start(perfctr_t *pc);
+
+/*
+ * perfctr_stop - Disable the counters and read them into pc->value,
+ *     scaling for any time the kernel multiplexed them out
+ */
+void perfctr_stop(perfctr_t *pc);
+
+/* perfctr_close - Release the counters */
+void perfctr_close(perfctr_t *pc);
+
+/* perfctr_name - Short printable name for an event */
+const char *perfctr_name(int event);
+
+#endif /* __PERFCTR_H_ */
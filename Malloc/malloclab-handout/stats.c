@@ -0,0 +1,149 @@
+/*
+ * stats.c - Small statistics helpers for summarizing repeated
+ *     measurements
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+/* Two-sided 95% critical values of Student's t for df = 1..30 */
+static const double t95_table[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+double stats_mean(const double *x, int n)
+{
+    int i;
+    double sum = 0;
+
+    if (n <= 0)
+        return 0;
+    for (i = 0; i < n; i++)
+        sum += x[i];
+    return sum / n;
+}
+
+double stats_stddev(const double *x, int n)
+{
+    int i;
+    double mean, d, sum = 0;
+
+    if (n < 2)
+        return 0;
+    mean = stats_mean(x, n);
+    for (i = 0; i < n; i++) {
+        d = x[i] - mean;
+        sum += d * d;
+    }
+    return sqrt(sum / (n - 1));
+}
+
+double stats_t95(double df)
+{
+    int d = (int)floor(df);
+
+    if (d < 1)
+        d = 1;
+    if (d <= 30)
+        return t95_table[d-1];
+    /* Good to three digits past the end of the table */
+    return 1.960 + 2.5 / d;
+}
+
+double stats_welch_ci95(const double *a, int na, const double *b, int nb)
+{
+    double va, vb, se2, df;
+
+    if (na < 2 || nb < 2)
+        return 0;
+    va = stats_stddev(a, na);
+    vb = stats_stddev(b, nb);
+    va = va * va / na;
+    vb = vb * vb / nb;
+    se2 = va + vb;
+    if (se2 == 0)
+        return 0;
+
+    /* Welch-Satterthwaite degrees of freedom */
+    df = se2 * se2 / (va * va / (na - 1) + vb * vb / (nb - 1));
+    return stats_t95(df) * sqrt(se2);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* sorted_copy - Return a sorted, malloc'ed copy of x[0..n-1] */
+static double *sorted_copy(const double *x, int n)
+{
+    double *y = malloc(n * sizeof(double));
+
+    if (y == NULL)
+        return NULL;
+    memcpy(y, x, n * sizeof(double));
+    qsort(y, n, sizeof(double), cmp_double);
+    return y;
+}
+
+/* median of an already sorted array */
+static double sorted_median(const double *y, int n)
+{
+    return (n % 2) ? y[n/2] : (y[n/2-1] + y[n/2]) / 2;
+}
+
+double stats_median(const double *x, int n)
+{
+    double *y, m;
+
+    if (n <= 0 || (y = sorted_copy(x, n)) == NULL)
+        return 0;
+    m = sorted_median(y, n);
+    free(y);
+    return m;
+}
+
+double stats_mad(const double *x, int n)
+{
+    double *dev, m;
+    int i;
+
+    if (n <= 0 || (dev = malloc(n * sizeof(double))) == NULL)
+        return 0;
+    m = stats_median(x, n);
+    for (i = 0; i < n; i++)
+        dev[i] = fabs(x[i] - m);
+    m = stats_median(dev, n);
+    free(dev);
+    return m;
+}
+
+void stats_median_ci95(const double *x, int n, double *lo, double *hi)
+{
+    double *y;
+    int j, k;
+
+    *lo = *hi = 0;
+    if (n <= 0 || (y = sorted_copy(x, n)) == NULL)
+        return;
+
+    /*
+     * The number of samples below the median is Binomial(n, 1/2), so
+     * the (1-based) ranks n/2 - 1.96*sqrt(n)/2 and 1 + n/2 + 1.96*sqrt(n)/2
+     * bracket it with ~95% probability.
+     */
+    j = (int)floor(n / 2.0 - 1.96 * sqrt(n) / 2.0) - 1;
+    k = (int)ceil(1 + n / 2.0 + 1.96 * sqrt(n) / 2.0) - 1;
+    if (j < 0)
+        j = 0;
+    if (k > n - 1)
+        k = n - 1;
+    *lo = y[j];
+    *hi = y[k];
+    free(y);
+}
@@ -0,0 +1,39 @@
+/*
+ * stats.h - Small statistics helpers for summarizing repeated
+ *     measurements
+ */
+#ifndef __STATS_H_
+#define __STATS_H_
+
+/* stats_mean - Arithmetic mean of x[0..n-1] */
+double stats_mean(const double *x, int n);
+
+/* stats_stddev - Sample standard deviation of x[0..n-1] (0 if n < 2) */
+double stats_stddev(const double *x, int n);
+
+/*
+ * stats_t95 - Two-sided 95% critical value of Student's t distribution
+ *     with df degrees of freedom (rounded down, to stay conservative)
+ */
+double stats_t95(double df);
+
+/*
+ * stats_welch_ci95 - 95% confidence half-width for the difference of
+ *     the means of two independent samples, using Welch's t-test
+ */
+double stats_welch_ci95(const double *a, int na, const double *b, int nb);
+
+/* stats_median - Median of x[0..n-1] (x is not modified) */
+double stats_median(const double *x, int n);
+
+/* stats_mad - Median absolute deviation of x[0..n-1] from its median */
+double stats_mad(const double *x, int n);
+
+/*
+ * stats_median_ci95 - Distribution-free 95% confidence interval for the
+ *     median of x[0..n-1], from the order statistics of the sample.
+ *     With too few samples for 95% coverage this is the sample range.
+ */
+void stats_median_ci95(const double *x, int n, double *lo, double *hi);
+
+#endif /* __STATS_H_ */
@@ -0,0 +1,242 @@
+/*
+ * attrib.c - Where in the cache and in the program the misses are
+ *
+ * Misses and evictions are counted per set, in arrays, and per block,
+ * in an array beside a table numbering the blocks (blocktab.c), so the
+ * blocks that suffer most and the sets they fight over can be listed
+ * after the run. A symbol file names the objects of the program, so
+ * that a block can be reported as the object and element it holds.
+ */
+#include "attrib.h"
+#include "blocktab.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Attribution {
+	const Cache *c;
+	long *accesses, *misses, *evictions;	/* per set */
+	BlockTab tab;
+	BlockCounts *blocks;	/* per block; addr is set when reported */
+};
+
+/* resize - Grow the counts per block along with the table */
+static int resize(void *arg, long max)
+{
+	Attribution *at = arg;
+	BlockCounts *blocks = realloc(at->blocks, max * sizeof(BlockCounts));
+
+	if(!blocks)
+		return 0;
+	at->blocks = blocks;
+	return 1;
+}
+
+Attribution *make_attribution(const Cache *c)
+{
+	Attribution *at = calloc(1, sizeof(Attribution));
+
+	if(!at)
+		return NULL;
+	at->c = c;
+	at->accesses = calloc(c->S, sizeof(long));
+	at->misses = calloc(c->S, sizeof(long));
+	at->evictions = calloc(c->S, sizeof(long));
+	if(!init_blocktab(&at->tab, resize, at) ||
+	   !at->accesses || !at->misses || !at->evictions) {
+		free_attribution(at);
+		return NULL;
+	}
+	return at;
+}
+
+void free_attribution(Attribution *at)
+{
+	free(at->accesses);
+	free(at->misses);
+	free(at->evictions);
+	free(at->blocks);
+	free_blocktab(&at->tab);
+	free(at);
+}
+
+/* counts - The counts of block, added if it's new; NULL if out of memory */
+static BlockCounts *counts(Attribution *at, unsigned long block)
+{
+	BlockCounts *bc;
+	int added;
+	long i;
+
+	if((i = block_index(&at->tab, block, &added)) < 0)
+		return NULL;
+	bc = &at->blocks[i];
+	if(added)
+		bc->misses = bc->evictions = 0;
+	return bc;
+}
+
+int attribute(Attribution *at, unsigned long addr, int r)
+{
+	const Cache *c = at->c;
+	BlockCounts *bc;
+	long set = (addr >> c->b) & (c->S - 1);
+
+	at->accesses[set]++;
+	if(!(r & MISS))
+		return 1;
+	at->misses[set]++;
+	if(!(bc = counts(at, addr >> c->b)))
+		return 0;
+	bc->misses++;
+	if(r & EVICT) {
+		at->evictions[set]++;
+		if(!(bc = counts(at, c->evicted >> c->b)))
+			return 0;
+		bc->evictions++;
+	}
+	return 1;
+}
+
+/* more_misses - Whether x has more misses than y, then more evictions */
+static int more_misses(const void *x, const void *y)
+{
+	const BlockCounts *a = x, *b = y;
+
+	return a->misses > b->misses ||
+	       (a->misses == b->misses && a->evictions > b->evictions);
+}
+
+int top_blocks(const Attribution *at, BlockCounts *out, int n)
+{
+	BlockCounts bc;
+	long i;
+	int k = 0;
+
+	for(i=0; i!=at->tab.n; ++i) {
+		bc = at->blocks[i];
+		bc.addr = at->tab.blocks[i] << at->c->b;
+		k = top_insert(out, k, n, sizeof(BlockCounts), &bc, more_misses);
+	}
+	return k;
+}
+
+long set_counts(const Attribution *at, const long **accesses,
+		const long **misses, const long **evictions)
+{
+	*accesses = at->accesses;
+	*misses = at->misses;
+	*evictions = at->evictions;
+	return at->c->S;
+}
+
+typedef struct {
+	char name[32];
+	unsigned long base;
+	long rows, cols, size;
+} Symbol;
+
+struct Symbols {
+	Symbol *syms;
+	int n;
+};
+
+Symbols *load_symbols(const char *path)
+{
+	Symbols *sy;
+	FILE *fp;
+	Symbol s;
+	int max = 0, n;
+
+	if((fp = fopen(path, "r")) == NULL)
+		return NULL;
+	if((sy = calloc(1, sizeof(Symbols))) == NULL) {
+		fclose(fp);
+		errno = ENOMEM;
+		return NULL;
+	}
+	while((n = fscanf(fp, "%31s %lx %ld %ld %ld", s.name, &s.base,
+			  &s.rows, &s.cols, &s.size)) != EOF) {
+		if(n != 5 || s.rows <= 0 || s.cols <= 0 || s.size <= 0) {
+			fprintf(stderr, "%s: bad symbol, line %d\n", path, sy->n + 1);
+			exit(1);
+		}
+		if(sy->n == max) {
+			max = max ? 2 * max : 8;
+			if(!(sy->syms = realloc(sy->syms, max * sizeof(Symbol)))) {
+				fprintf(stderr, "%s: out of memory\n", path);
+				exit(1);
+			}
+		}
+		sy->syms[sy->n++] = s;
+	}
+	fclose(fp);
+	return sy;
+}
+
+void free_symbols(Symbols *sy)
+{
+	free(sy->syms);
+	free(sy);
+}
+
+int find_symbol(const Symbols *sy, unsigned long addr)
+{
+	const Symbol *s;
+	int i;
+
+	for(i=0; i!=sy->n; ++i) {
+		s = &sy->syms[i];
+		if(addr >= s->base &&
+		   addr - s->base < (unsigned long)(s->rows * s->cols * s->size))
+			return i;
+	}
+	return -1;
+}
+
+int nsymbols(const Symbols *sy)
+{
+	return sy->n;
+}
+
+const char *symbol_name(const Symbols *sy, int i)
+{
+	return sy->syms[i].name;
+}
+
+void symbol_counts(const Attribution *at, const Symbols *sy, long *misses,
+		   long *evictions)
+{
+	long i;
+	int k;
+
+	memset(misses, 0, sy->n * sizeof(long));
+	memset(evictions, 0, sy->n * sizeof(long));
+	for(i=0; i!=at->tab.n; ++i) {
+		if((k = find_symbol(sy, at->tab.blocks[i] << at->c->b)) < 0)
+			continue;
+		misses[k] += at->blocks[i].misses;
+		evictions[k] += at->blocks[i].evictions;
+	}
+}
+
+void symbolize(const Symbols *sy, unsigned long addr, char *buf, int len)
+{
+	const Symbol *s;
+	unsigned long off;
+	int i = sy ? find_symbol(sy, addr) : -1;
+
+	if(i < 0) {
+		snprintf(buf, len, "%lx", addr);
+		return;
+	}
+	s = &sy->syms[i];
+	off = addr - s->base;
+	if(s->rows > 1 || s->size > 1)
+		snprintf(buf, len, "%s[%ld][%ld]", s->name,
+			 (long)(off / s->size / s->cols),
+			 (long)(off / s->size % s->cols));
+	else
+		snprintf(buf, len, "%s+0x%lx", s->name, off);
+}
@@ -0,0 +1,72 @@
+/*
+ * attrib.h - Where in the cache and in the program the misses are
+ */
+#ifndef ATTRIB_H
+#define ATTRIB_H
+
+#include "cache.h"
+
+typedef struct Attribution Attribution;
+
+/* One block's counts, for the report */
+typedef struct {
+	unsigned long addr;
+	long misses;
+	long evictions;		/* times it was the victim */
+} BlockCounts;
+
+/* make_attribution - Counts for the cache c; NULL if out of memory */
+Attribution *make_attribution(const Cache *c);
+void free_attribution(Attribution *at);
+
+/*
+ * attribute - Count an access to addr that had result r in the cache;
+ * after an EVICT the victim is at the cache's evicted. Returns 0 if
+ * out of memory.
+ */
+int attribute(Attribution *at, unsigned long addr, int r);
+
+/*
+ * top_blocks - The n blocks (at most) with the most misses, then
+ * evictions, worst first, into out. Returns how many.
+ */
+int top_blocks(const Attribution *at, BlockCounts *out, int n);
+
+/*
+ * set_counts - Accesses, misses and evictions of each set; returns the
+ * number of sets
+ */
+long set_counts(const Attribution *at, const long **accesses,
+		const long **misses, const long **evictions);
+
+typedef struct Symbols Symbols;
+
+/*
+ * load_symbols - Read lines "<name> <hex base> <rows> <cols> <bytes>",
+ * one per object: a matrix of rows by cols elements of the given size,
+ * in row-major order, or anything else as a 1 by n array of bytes.
+ * tracegen writes A and B this way to .symbols. Returns NULL, with
+ * errno set, if the file can't be read, and exits if it's malformed.
+ */
+Symbols *load_symbols(const char *path);
+void free_symbols(Symbols *sy);
+
+/* find_symbol - The object addr is in, numbered from 0 in file order, or -1 */
+int find_symbol(const Symbols *sy, unsigned long addr);
+int nsymbols(const Symbols *sy);
+const char *symbol_name(const Symbols *sy, int i);
+
+/*
+ * symbol_counts - Misses and evictions of the blocks starting in each
+ * object, into arrays of nsymbols
+ */
+void symbol_counts(const Attribution *at, const Symbols *sy, long *misses,
+		   long *evictions);
+
+/*
+ * symbolize - Name addr in buf: "A[3][17]" in a matrix, "name+0x1c" in
+ * other objects, or the address in hex
+ */
+void symbolize(const Symbols *sy, unsigned long addr, char *buf, int len);
+
+#endif /* ATTRIB_H */
@@ -0,0 +1,108 @@
+/*
+ * blocktab.c - Numbering the blocks a trace touches
+ *
+ * Block numbers are hashed by Fibonacci hashing into a table of slots
+ * at most half full, probed linearly; each slot holds the index of a
+ * block. The indexes are handed out densely, so the modules that count
+ * things per block keep plain arrays beside the table and grow them
+ * when it asks.
+ */
+#include "blocktab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static inline unsigned long hash(const BlockTab *t, unsigned long block)
+{
+	return (block * 0x9E3779B97F4A7C15UL) >> (64 - t->hbits);
+}
+
+int init_blocktab(BlockTab *t, int (*resize)(void *arg, long max), void *arg)
+{
+	memset(t, 0, sizeof(BlockTab));
+	t->resize = resize;
+	t->arg = arg;
+	t->hbits = 10;
+	if(!(t->slots = malloc(sizeof(long) << t->hbits)))
+		return 0;
+	memset(t->slots, -1, sizeof(long) << t->hbits);
+	return 1;
+}
+
+void free_blocktab(BlockTab *t)
+{
+	free(t->blocks);
+	free(t->slots);
+}
+
+/* grow - Make room for more blocks, rehashing when the table fills */
+static int grow(BlockTab *t)
+{
+	long max = t->max ? 2 * t->max : 1024;
+	unsigned long *blocks = realloc(t->blocks, max * sizeof(unsigned long));
+	unsigned long h, mask;
+	long i;
+
+	if(!blocks)
+		return 0;
+	t->blocks = blocks;
+	if(!t->resize(t->arg, max))
+		return 0;
+	t->max = max;
+	if(2 * max <= 1L << t->hbits)
+		return 1;
+
+	free(t->slots);
+	t->hbits++;
+	if(!(t->slots = malloc(sizeof(long) << t->hbits)))
+		return 0;
+	memset(t->slots, -1, sizeof(long) << t->hbits);
+	mask = (1UL << t->hbits) - 1;
+	for(i=0; i!=t->n; ++i) {
+		for(h = hash(t, t->blocks[i]); t->slots[h] >= 0; h = (h + 1) & mask)
+			;
+		t->slots[h] = i;
+	}
+	return 1;
+}
+
+long block_index(BlockTab *t, unsigned long block, int *added)
+{
+	unsigned long mask = (1UL << t->hbits) - 1;
+	unsigned long h;
+
+	for(h = hash(t, block); t->slots[h] >= 0; h = (h + 1) & mask) {
+		if(t->blocks[t->slots[h]] == block) {
+			if(added)
+				*added = 0;
+			return t->slots[h];
+		}
+	}
+	if(t->n == t->max) {
+		if(!grow(t))
+			return -1;
+		return block_index(t, block, added);
+	}
+	if(added)
+		*added = 1;
+	t->blocks[t->n] = block;
+	t->slots[h] = t->n;
+	return t->n++;
+}
+
+int top_insert(void *top, int k, int n, size_t size, const void *x,
+	       int (*better)(const void *x, const void *y))
+{
+	char *t = top;
+	int j;
+
+	for(j = k < n ? k++ : n; j > 0; --j) {
+		if(!better(x, t + (j-1) * size))
+			break;
+		if(j < n)
+			memcpy(t + j * size, t + (j-1) * size, size);
+	}
+	if(j < n)
+		memcpy(t + j * size, x, size);
+	return k;
+}
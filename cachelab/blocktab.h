@@ -0,0 +1,44 @@
+/*
+ * blocktab.h - Numbering the blocks a trace touches
+ */
+#ifndef BLOCKTAB_H
+#define BLOCKTAB_H
+
+#include <stddef.h>
+
+/*
+ * A table from block numbers to indexes 0, 1, ... in order of first
+ * sight, so that a module can keep what it counts per block in arrays
+ * of its own. When the table needs more indexes it calls resize, which
+ * must grow those arrays to max entries and return 0 if out of memory.
+ */
+typedef struct {
+	unsigned long *blocks;	/* per index */
+	long n, max;
+	long *slots;		/* open addressed: an index, or -1 */
+	int hbits;
+	int (*resize)(void *arg, long max);
+	void *arg;
+} BlockTab;
+
+/* init_blocktab - An empty table; returns 0 if out of memory */
+int init_blocktab(BlockTab *t, int (*resize)(void *arg, long max), void *arg);
+void free_blocktab(BlockTab *t);
+
+/*
+ * block_index - The index of block, giving it the next one if it is
+ * new, in which case *added is set (if added isn't NULL). Returns -1
+ * if out of memory.
+ */
+long block_index(BlockTab *t, unsigned long block, int *added);
+
+/*
+ * top_insert - Offer x to top, an array of the k best so far (out of
+ * at most n) of elements of size bytes, best first, where better(x, y)
+ * says whether x goes ahead of y; ties keep the earlier one first.
+ * Returns the new k.
+ */
+int top_insert(void *top, int k, int n, size_t size, const void *x,
+	       int (*better)(const void *x, const void *y));
+
+#endif /* BLOCKTAB_H */
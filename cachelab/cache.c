@@ -0,0 +1,197 @@
+/*
+ * cache.c - One set-associative cache for the simulator
+ *
+ * All S*E lines live in one flat array. Tags are found through a small
+ * chained hash table per set, so the lookup is O(1) whatever the
+ * associativity. Invalid lines are kept on a list of their own and
+ * filled first, in way order when the cache is new; once a set is full
+ * its replacement policy picks the line to evict.
+ */
+#include "cache.h"
+
+#include <stdlib.h>
+
+#define NIL (-1)
+
+/* Which bucket of its set a tag hashes to */
+static inline int bucket(const Cache *c, unsigned long tag)
+{
+	if(c->hbits == 0)
+		return 0;
+	return (int)((tag * 0x9E3779B97F4A7C15UL) >> (64 - c->hbits));
+}
+
+static inline long set_of(const Cache *c, unsigned long addr)
+{
+	return (addr >> c->b) & (c->S - 1);
+}
+
+static inline unsigned long tag_of(const Cache *c, unsigned long addr)
+{
+	return (c->s + c->b < 64) ? addr >> (c->s + c->b) : 0;
+}
+
+static inline int *head_of(const Cache *c, long set, unsigned long tag)
+{
+	return &c->buckets[(set << c->hbits) + bucket(c, tag)];
+}
+
+/* find - The line holding the block at addr, or NIL */
+static inline int find(const Cache *c, unsigned long addr)
+{
+	unsigned long tag = tag_of(c, addr);
+	int i;
+
+	for(i = *head_of(c, set_of(c, addr), tag); i != NIL; i = c->lines[i].hnext)
+		if(c->lines[i].tag == tag)
+			return i;
+	return NIL;
+}
+
+/* unhash - Take valid line i of set out of its hash chain */
+static void unhash(Cache *c, long set, int i)
+{
+	int *pp = head_of(c, set, c->lines[i].tag);
+
+	while(*pp != i)
+		pp = &c->lines[*pp].hnext;
+	*pp = c->lines[i].hnext;
+}
+
+Cache *make_cache(int s, int E, int b, const Policy *policy,
+		  unsigned long seed)
+{
+	Cache *c = calloc(1, sizeof(Cache));
+	long i;
+	long nbuckets;
+
+	if(!c)
+		return NULL;
+	c->s = s;
+	c->E = E;
+	c->b = b;
+	c->S = 1L << s;
+	c->policy = policy;
+	/* about one bucket per line keeps the chains short */
+	while((1 << c->hbits) < E)
+		c->hbits++;
+
+	nbuckets = c->S << c->hbits;
+	c->invalid = malloc(c->S * sizeof(int));
+	c->lines = malloc(c->S * E * sizeof(Line));
+	c->buckets = malloc(nbuckets * sizeof(int));
+	c->pstate = policy->create(c->S, E, seed);
+	if(!c->invalid || !c->lines || !c->buckets || !c->pstate) {
+		if(c->pstate)
+			policy->destroy(c->pstate);
+		free(c->invalid);
+		free(c->lines);
+		free(c->buckets);
+		free(c);
+		return NULL;
+	}
+	for(i=0; i!=nbuckets; ++i)
+		c->buckets[i] = NIL;
+	for(i=0; i!=c->S * E; ++i)
+		c->lines[i].hnext = (i + 1) % E ? (int)i + 1 : NIL;
+	for(i=0; i!=c->S; ++i)
+		c->invalid[i] = (int)(i * E);
+	return c;
+}
+
+void free_cache(Cache *c)
+{
+	c->policy->destroy(c->pstate);
+	free(c->invalid);
+	free(c->lines);
+	free(c->buckets);
+	free(c);
+}
+
+int probe_cache(const Cache *c, unsigned long addr)
+{
+	return find(c, addr) != NIL;
+}
+
+int fill_cache(Cache *c, unsigned long addr, long next, int dirty)
+{
+	long set = set_of(c, addr);
+	unsigned long tag = tag_of(c, addr);
+	int *head = head_of(c, set, tag);
+	int i, way;
+	int result = 0;
+
+	if((i = c->invalid[set]) != NIL) {
+		c->invalid[set] = c->lines[i].hnext;
+		way = (int)(i - set * c->E);
+	} else {
+		/* evict the policy's victim */
+		way = c->policy->victim(c->pstate, set);
+		i = (int)(set * c->E) + way;
+		unhash(c, set, i);
+		c->evicted = ((c->lines[i].tag << c->s | set) << c->b);
+		c->evictions++;
+		result = EVICT;
+		if(c->lines[i].dirty) {
+			c->dirty_evictions++;
+			result |= DIRTY;
+		}
+	}
+	c->lines[i].tag = tag;
+	c->lines[i].dirty = dirty;
+	c->lines[i].hnext = *head;
+	*head = i;
+	c->policy->fill(c->pstate, set, way, next);
+	return result;
+}
+
+int invalidate_cache(Cache *c, unsigned long addr)
+{
+	long set = set_of(c, addr);
+	int i = find(c, addr);
+
+	if(i == NIL)
+		return 0;
+	unhash(c, set, i);
+	c->lines[i].hnext = c->invalid[set];
+	c->invalid[set] = i;
+	if(c->policy->drop)
+		c->policy->drop(c->pstate, set, (int)(i - set * c->E));
+	return c->lines[i].dirty ? HIT | DIRTY : HIT;
+}
+
+int update_cache(Cache *c, unsigned long addr)
+{
+	int i = find(c, addr);
+
+	if(i == NIL || c->write_through)
+		return 0;
+	c->lines[i].dirty = 1;
+	return 1;
+}
+
+int access_cache(Cache *c, unsigned long addr, long next, int write)
+{
+	int i = find(c, addr);
+	long set;
+
+	if(i != NIL) {
+		c->hits++;
+		set = set_of(c, addr);
+		c->policy->hit(c->pstate, set, (int)(i - set * c->E), next);
+		if(!write)
+			return HIT;
+		if(c->write_through)
+			return HIT | WRITE;
+		c->lines[i].dirty = 1;
+		return HIT;
+	}
+	c->misses++;
+	if(!write)
+		return MISS | fill_cache(c, addr, next, 0);
+	if(c->no_write_allocate)
+		return MISS | WRITE;
+	if(c->write_through)
+		return MISS | WRITE | fill_cache(c, addr, next, 0);
+	return MISS | fill_cache(c, addr, next, 1);
+}
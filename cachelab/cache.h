@@ -0,0 +1,81 @@
+/*
+ * cache.h - One set-associative cache for the simulator
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "policy.h"
+
+typedef struct {
+	unsigned long tag;
+	int hnext;		/* next line in the same hash bucket, or
+				   next invalid way of the set */
+	int dirty;		/* written since it was filled */
+} Line;
+
+typedef struct {
+	int s, E, b;
+	long S;
+	int hbits;		/* log2 of the hash buckets per set */
+	int *invalid;		/* per set, a list of its invalid lines */
+	Line *lines;		/* S*E lines; set i owns [i*E, i*E+E) */
+	int *buckets;		/* S << hbits bucket heads */
+	const Policy *policy;
+	void *pstate;
+	int write_through;	/* else write-back */
+	int no_write_allocate;	/* else write-allocate */
+	unsigned long evicted;	/* block address of the last eviction */
+	long hits, misses, evictions;
+	long dirty_evictions;	/* each writes back 2^b bytes */
+} Cache;
+
+/*
+ * Results of one access, for the verbose output. DIRTY goes with EVICT
+ * when the line evicted has to be written back; WRITE means the store
+ * has to go on to the next level, because the cache writes through or
+ * because it missed and doesn't allocate on a write.
+ */
+#define HIT   1
+#define MISS  2
+#define EVICT 4
+#define DIRTY 8
+#define WRITE 16
+
+/*
+ * make_cache - An empty cache of 2^s sets of E lines of 2^b bytes,
+ * replacing lines by policy (seed is for the randomized ones). It is
+ * write-back and write-allocate until told otherwise. Returns NULL if
+ * out of memory.
+ */
+Cache *make_cache(int s, int E, int b, const Policy *policy,
+		  unsigned long seed);
+void free_cache(Cache *c);
+
+/*
+ * access_cache - Simulate one load (write 0) or store (write 1) to the
+ * block at addr, whose next access is at time next (NEVER if none, or
+ * if nobody knows). Returns a combination of the results above; after
+ * an EVICT the block that went is at c->evicted.
+ */
+int access_cache(Cache *c, unsigned long addr, long next, int write);
+
+/*
+ * The pieces of an access, for caches in a hierarchy. None of them
+ * touch the hit and miss counts.
+ *
+ * probe_cache - Whether the block at addr is in the cache
+ * fill_cache - Bring in the block at addr, which isn't in the cache,
+ *     clean or dirty; returns EVICT (and DIRTY), with the block at
+ *     c->evicted, if one had to go
+ * invalidate_cache - Drop the block at addr; returns HIT if it was in
+ *     the cache, with DIRTY if it has to be written back
+ * update_cache - Take a write of (part of) the block at addr from the
+ *     level above: a write-back cache holding the block keeps it and
+ *     returns 1; otherwise it has to go on down
+ */
+int probe_cache(const Cache *c, unsigned long addr);
+int fill_cache(Cache *c, unsigned long addr, long next, int dirty);
+int invalidate_cache(Cache *c, unsigned long addr);
+int update_cache(Cache *c, unsigned long addr);
+
+#endif /* CACHE_H */
@@ -0,0 +1,167 @@
+/*
+ * classify.c - Compulsory, capacity and conflict misses
+ *
+ * Beside the real cache runs a fully associative LRU cache of the same
+ * number of lines. A miss on a block never touched before is
+ * compulsory; any other miss that the fully associative cache also has
+ * is for want of capacity, and one it doesn't have is a conflict, down
+ * to the mapping of blocks to sets (Hill's 3C model). Misses the other
+ * way round, where only the fully associative cache misses, are left
+ * out of the count.
+ *
+ * Every block seen gets a node, numbered by a block table (blocktab.c),
+ * which is how first touches are told apart. The nodes of the blocks in
+ * the fully associative cache are also on a list, most recently used
+ * first, so an access is a constant amount of work however large the
+ * cache.
+ */
+#include "classify.h"
+#include "blocktab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NONE (-1L)
+
+typedef struct {
+	long prev, next;	/* on the LRU list, if resident */
+	int resident;
+} Node;
+
+struct Classifier {
+	const Cache *c;
+	const Symbols *sy;
+	long lines;		/* capacity of the fully associative cache */
+	long resident;
+	long head, tail;	/* most and least recently used */
+	BlockTab tab;
+	Node *nodes;		/* per block in tab */
+	long (*counts)[MISS_KINDS];	/* per object, then all */
+};
+
+/* resize - Grow the nodes along with the table */
+static int resize(void *arg, long max)
+{
+	Classifier *cl = arg;
+	Node *nodes = realloc(cl->nodes, max * sizeof(Node));
+
+	if(!nodes)
+		return 0;
+	cl->nodes = nodes;
+	return 1;
+}
+
+Classifier *make_classifier(const Cache *c, const Symbols *sy)
+{
+	Classifier *cl = calloc(1, sizeof(Classifier));
+
+	if(!cl)
+		return NULL;
+	cl->c = c;
+	cl->sy = sy;
+	cl->lines = c->S * c->E;
+	cl->head = cl->tail = NONE;
+	cl->counts = calloc((sy ? nsymbols(sy) : 0) + 1, sizeof(*cl->counts));
+	if(!init_blocktab(&cl->tab, resize, cl) || !cl->counts) {
+		free_classifier(cl);
+		return NULL;
+	}
+	return cl;
+}
+
+void free_classifier(Classifier *cl)
+{
+	free(cl->nodes);
+	free_blocktab(&cl->tab);
+	free(cl->counts);
+	free(cl);
+}
+
+static void unlink_node(Classifier *cl, long i)
+{
+	Node *nd = &cl->nodes[i];
+
+	if(nd->prev != NONE)
+		cl->nodes[nd->prev].next = nd->next;
+	else
+		cl->head = nd->next;
+	if(nd->next != NONE)
+		cl->nodes[nd->next].prev = nd->prev;
+	else
+		cl->tail = nd->prev;
+}
+
+static void push_front(Classifier *cl, long i)
+{
+	Node *nd = &cl->nodes[i];
+
+	nd->prev = NONE;
+	nd->next = cl->head;
+	if(cl->head != NONE)
+		cl->nodes[cl->head].prev = i;
+	else
+		cl->tail = i;
+	cl->head = i;
+}
+
+/*
+ * touch - Access block in the fully associative cache. Returns the
+ * kind of miss it would be, or -1 for a hit; -2 if out of memory.
+ */
+static int touch(Classifier *cl, unsigned long block)
+{
+	long i;
+	int added, kind;
+
+	if((i = block_index(&cl->tab, block, &added)) < 0)
+		return -2;
+	if(added) {
+		kind = COMPULSORY;
+	} else if(cl->nodes[i].resident) {
+		unlink_node(cl, i);
+		push_front(cl, i);
+		return -1;
+	} else {
+		kind = CAPACITY;
+	}
+	if(cl->resident == cl->lines) {
+		cl->nodes[cl->tail].resident = 0;
+		unlink_node(cl, cl->tail);
+	} else {
+		cl->resident++;
+	}
+	cl->nodes[i].resident = 1;
+	push_front(cl, i);
+	return kind;
+}
+
+int classify(Classifier *cl, unsigned long addr, int r)
+{
+	int kind = touch(cl, addr >> cl->c->b);
+	int i;
+
+	if(kind == -2)
+		return 0;
+	if(!(r & MISS))
+		return 1;
+	if(kind < 0)
+		kind = CONFLICT;
+	i = cl->sy ? find_symbol(cl->sy, addr) : -1;
+	if(i >= 0)
+		cl->counts[i][kind]++;
+	cl->counts[cl->sy ? nsymbols(cl->sy) : 0][kind]++;
+	return 1;
+}
+
+void miss_kinds(const Classifier *cl, int i, long *out)
+{
+	if(i < 0)
+		i = cl->sy ? nsymbols(cl->sy) : 0;
+	memcpy(out, cl->counts[i], sizeof(cl->counts[i]));
+}
+
+const char *miss_kind_name(int kind)
+{
+	return kind == COMPULSORY ? "compulsory" : kind == CAPACITY ? "capacity" :
+		"conflict";
+}
@@ -0,0 +1,37 @@
+/*
+ * classify.h - Compulsory, capacity and conflict misses
+ */
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include "cache.h"
+#include "attrib.h"
+
+/* Kinds of miss */
+enum { COMPULSORY, CAPACITY, CONFLICT, MISS_KINDS };
+
+typedef struct Classifier Classifier;
+
+/*
+ * make_classifier - Classify the misses of the cache c, per object of
+ * sy as well if it isn't NULL. Returns NULL if out of memory.
+ */
+Classifier *make_classifier(const Cache *c, const Symbols *sy);
+void free_classifier(Classifier *cl);
+
+/*
+ * classify - Count an access to addr that had result r in the cache.
+ * Returns 0 if out of memory.
+ */
+int classify(Classifier *cl, unsigned long addr, int r);
+
+/*
+ * miss_kinds - The misses of each kind in object i of the symbols, or
+ * in all if i is -1, into out[MISS_KINDS]
+ */
+void miss_kinds(const Classifier *cl, int i, long *out);
+
+/* miss_kind_name - "compulsory", "capacity" or "conflict" */
+const char *miss_kind_name(int kind);
+
+#endif /* CLASSIFY_H */
@@ -0,0 +1,344 @@
+/*
+ * coherence.c - Private caches per core kept coherent over a shared one
+ *
+ * Each core has a private cache in front of a shared cache (or memory),
+ * joined by a snooping bus. The private caches only keep the blocks
+ * and their replacement order; which core holds what, and in which
+ * state, is in a directory beside them. Under MESI and MOESI at most
+ * one core has a block Exclusive, Owned or Modified, and any others
+ * hold it Shared, so the directory keeps the cores holding the block
+ * and the one owner with its state.
+ *
+ * A load miss takes the block from a dirty copy if there is one (which
+ * under MESI is written back and becomes Shared, and under MOESI
+ * becomes Owned), and otherwise from the shared cache, Exclusive if no
+ * one else has it. A store to a block the core doesn't own outright
+ * invalidates every other copy. Write-backs go to the shared cache if
+ * it has the block, else to memory, as in hierarchy.c.
+ *
+ * To tell false sharing from true, the directory also records which
+ * bytes of the block each copy has touched. An invalidation is false
+ * sharing when the store that caused it touched none of them.
+ */
+#include "coherence.h"
+#include "blocktab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* States of the owner of a block; the other holders are Shared */
+enum { ST_E, ST_O, ST_M };
+
+typedef struct {
+	unsigned long sharers;	/* bit per core holding it */
+	unsigned long lost;	/* cores whose copy a store took away */
+	unsigned long cores;	/* cores that ever touched it */
+	int owner;		/* core in E, O or M, or -1 */
+	int state;		/* the owner's */
+	int writer;		/* last core to store to it, or -1 */
+	long pingpongs;
+	long invalidations;
+	long false_invalidations;
+} Block;
+
+struct Directory {
+	BlockTab tab;
+	Block *blocks;		/* per block in tab */
+	unsigned long *used;	/* per block, a byte mask per core */
+	int ncores;
+	int b;
+	int gshift;		/* log2 of the bytes per bit of a used mask */
+};
+
+/* resize - Grow the blocks and their used masks along with the table */
+static int resize(void *arg, long max)
+{
+	Directory *d = arg;
+	Block *blocks = realloc(d->blocks, max * sizeof(Block));
+	unsigned long *used;
+
+	if(!blocks)
+		return 0;
+	d->blocks = blocks;
+	if(!(used = realloc(d->used, max * d->ncores * sizeof(unsigned long))))
+		return 0;
+	d->used = used;
+	return 1;
+}
+
+static Directory *make_directory(int ncores, int b)
+{
+	Directory *d = calloc(1, sizeof(Directory));
+
+	if(!d)
+		return NULL;
+	d->ncores = ncores;
+	d->b = b;
+	d->gshift = b > 6 ? b - 6 : 0;
+	if(!init_blocktab(&d->tab, resize, d)) {
+		free(d);
+		return NULL;
+	}
+	return d;
+}
+
+static void free_directory(Directory *d)
+{
+	free(d->blocks);
+	free(d->used);
+	free_blocktab(&d->tab);
+	free(d);
+}
+
+/* lookup - The index of block, added if it's new; -1 if out of memory */
+static long lookup(Directory *d, unsigned long block)
+{
+	Block *bl;
+	int added;
+	long i;
+
+	if((i = block_index(&d->tab, block, &added)) < 0 || !added)
+		return i;
+	bl = &d->blocks[i];
+	memset(bl, 0, sizeof(Block));
+	bl->owner = bl->writer = -1;
+	memset(&d->used[i * d->ncores], 0, d->ncores * sizeof(unsigned long));
+	return i;
+}
+
+/* byte_mask - The bits of a used mask that size bytes at addr cover */
+static unsigned long byte_mask(const Directory *d, unsigned long addr, int size)
+{
+	unsigned long off = addr & ((1UL << d->b) - 1);
+	unsigned long last = ((1UL << d->b) - 1) >> d->gshift;
+	unsigned long lo = off >> d->gshift;
+	unsigned long hi = (off + (size > 0 ? size : 1) - 1) >> d->gshift;
+
+	if(hi > last)
+		hi = last;
+	return (hi == 63 ? ~0UL : (2UL << hi) - 1) & ~((1UL << lo) - 1);
+}
+
+Coherence *make_coherence(int protocol, int ncores, const LevelConfig *priv,
+			  const LevelConfig *shared, unsigned long seed)
+{
+	Coherence *co = calloc(1, sizeof(Coherence));
+	int i;
+
+	if(!co)
+		return NULL;
+	co->protocol = protocol;
+	if(!(co->dir = make_directory(ncores, priv->b))) {
+		free(co);
+		return NULL;
+	}
+	for(i=0; i!=ncores; ++i, co->ncores++) {
+		if(!(co->cores[i] = make_cache(priv->s, priv->E, priv->b,
+					       priv->policy, seed))) {
+			free_coherence(co);
+			return NULL;
+		}
+	}
+	if(shared && !(co->shared = make_cache(shared->s, shared->E, shared->b,
+					       shared->policy, seed))) {
+		free_coherence(co);
+		return NULL;
+	}
+	return co;
+}
+
+void free_coherence(Coherence *co)
+{
+	int i;
+
+	for(i=0; i!=co->ncores; ++i)
+		free_cache(co->cores[i]);
+	if(co->shared)
+		free_cache(co->shared);
+	free_directory(co->dir);
+	free(co);
+}
+
+/* fetch - Read the block at addr from the shared cache or memory */
+static void fetch(Coherence *co, unsigned long addr)
+{
+	int r;
+
+	if(!co->shared) {
+		co->mem_reads++;
+		return;
+	}
+	r = access_cache(co->shared, addr, NEVER, 0);
+	if(r & MISS)
+		co->mem_reads++;
+	if(r & DIRTY)
+		co->mem_writes++;
+}
+
+/* write_back - A dirty block at addr leaves a core */
+static void write_back(Coherence *co, unsigned long addr)
+{
+	co->writebacks++;
+	if(!co->shared || !update_cache(co->shared, addr))
+		co->mem_writes++;
+}
+
+/* evicted - Core c's cache evicted the block at addr */
+static void evicted(Coherence *co, int c, unsigned long addr)
+{
+	Directory *d = co->dir;
+	long i = lookup(d, addr >> d->b);	/* known, so can't fail */
+	Block *bl = &d->blocks[i];
+
+	bl->sharers &= ~(1UL << c);
+	d->used[i * d->ncores + c] = 0;
+	if(bl->owner == c) {
+		if(bl->state != ST_E)
+			write_back(co, addr);
+		bl->owner = -1;
+	}
+}
+
+/*
+ * invalidate_others - Core c stores to the bytes in mask of block i:
+ * every other copy goes
+ */
+static void invalidate_others(Coherence *co, long i, int c, unsigned long mask)
+{
+	Directory *d = co->dir;
+	Block *bl = &d->blocks[i];
+	unsigned long *used = &d->used[i * d->ncores];
+	unsigned long addr = d->tab.blocks[i] << d->b;
+	int o;
+
+	for(o=0; o!=d->ncores; ++o) {
+		if(o == c || !(bl->sharers & 1UL << o))
+			continue;
+		invalidate_cache(co->cores[o], addr);
+		co->stats[o].invalidated++;
+		co->invalidations++;
+		bl->invalidations++;
+		if(!(used[o] & mask)) {
+			co->false_invalidations++;
+			bl->false_invalidations++;
+		}
+		used[o] = 0;
+		bl->lost |= 1UL << o;
+	}
+	bl->sharers &= 1UL << c;
+}
+
+/* access1 - One load or store of size bytes at addr by core c */
+static int access1(Coherence *co, int c, unsigned long addr, int size,
+		   int write)
+{
+	Directory *d = co->dir;
+	Cache *pc = co->cores[c];
+	unsigned long me = 1UL << c, mask;
+	Block *bl;
+	long i;
+	int r, dirty;
+
+	r = access_cache(pc, addr, NEVER, 0);
+	if(r & EVICT)
+		evicted(co, c, pc->evicted);
+	if((i = lookup(d, addr >> d->b)) < 0)
+		return 0;
+	bl = &d->blocks[i];
+	mask = byte_mask(d, addr, size);
+	bl->cores |= me;
+	dirty = bl->owner >= 0 && bl->state != ST_E;
+
+	if(r & MISS) {
+		if(bl->lost & me) {
+			co->stats[c].coherence_misses++;
+			bl->lost &= ~me;
+		}
+		if(dirty) {
+			co->transfers++;
+			co->stats[c].transfers_in++;
+		} else {
+			fetch(co, addr);
+		}
+	}
+
+	if(!write) {
+		if(r & MISS) {
+			co->bus_reads++;
+			if(dirty && co->protocol == MOESI) {
+				bl->state = ST_O;
+			} else if(bl->owner >= 0) {
+				if(dirty)
+					write_back(co, addr);
+				bl->owner = -1;
+			}
+			if(!bl->sharers) {
+				bl->owner = c;
+				bl->state = ST_E;
+			}
+			bl->sharers |= me;
+		}
+	} else {
+		if(r & MISS)
+			co->bus_read_excl++;
+		else if(bl->owner != c || bl->state == ST_O)
+			co->stats[c].upgrades++;
+		invalidate_others(co, i, c, mask);
+		bl->sharers = me;
+		bl->owner = c;
+		bl->state = ST_M;
+		if(bl->writer >= 0 && bl->writer != c)
+			bl->pingpongs++;
+		bl->writer = c;
+	}
+	d->used[i * d->ncores + c] |= mask;
+	return 1;
+}
+
+int coherent_access(Coherence *co, const Ref *r)
+{
+	if(!access1(co, r->core, r->addr, r->size, r->op == 'S'))
+		return 0;
+	return r->op != 'M' || access1(co, r->core, r->addr, r->size, 1);
+}
+
+/* worse - Whether x changed hands more than y, then was invalidated more */
+static int worse(const void *x, const void *y)
+{
+	const BlockReport *a = x, *b = y;
+
+	return a->pingpongs > b->pingpongs ||
+	       (a->pingpongs == b->pingpongs &&
+		a->invalidations > b->invalidations);
+}
+
+int worst_blocks(const Coherence *co, BlockReport *out, int n)
+{
+	const Directory *d = co->dir;
+	const Block *bl;
+	BlockReport r;
+	long i;
+	int k = 0;
+
+	for(i=0; i!=d->tab.n; ++i) {
+		bl = &d->blocks[i];
+		if(!bl->pingpongs && !bl->invalidations)
+			continue;
+		r.addr = d->tab.blocks[i] << d->b;
+		r.pingpongs = bl->pingpongs;
+		r.invalidations = bl->invalidations;
+		r.false_invalidations = bl->false_invalidations;
+		r.cores = bl->cores;
+		k = top_insert(out, k, n, sizeof(BlockReport), &r, worse);
+	}
+	return k;
+}
+
+int parse_protocol(const char *name)
+{
+	if(strcmp(name, "mesi") == 0)
+		return MESI;
+	if(strcmp(name, "moesi") == 0)
+		return MOESI;
+	return -1;
+}
@@ -0,0 +1,72 @@
+/*
+ * coherence.h - Private caches per core kept coherent over a shared one
+ */
+#ifndef COHERENCE_H
+#define COHERENCE_H
+
+#include "hierarchy.h"
+#include "trace.h"
+
+/* Protocols */
+enum { MESI, MOESI };
+
+/* What one core saw */
+typedef struct {
+	long coherence_misses;	/* misses on blocks another core's write took */
+	long upgrades;		/* writes to shared or owned copies */
+	long invalidated;	/* copies it lost to other cores' writes */
+	long transfers_in;	/* misses a dirty copy elsewhere served */
+} CoreStats;
+
+typedef struct Directory Directory;
+
+typedef struct {
+	int protocol;
+	int ncores;
+	Cache *cores[MAX_CORES];	/* the private caches */
+	Cache *shared;			/* or NULL, for memory right behind */
+	CoreStats stats[MAX_CORES];
+	Directory *dir;
+	long bus_reads;			/* misses to read */
+	long bus_read_excl;		/* misses to write */
+	long invalidations;		/* copies invalidated */
+	long false_invalidations;	/* of which false sharing */
+	long transfers;			/* cache-to-cache, of dirty data */
+	long writebacks;		/* dirty blocks out of a core */
+	long mem_reads, mem_writes;	/* blocks */
+} Coherence;
+
+/* One block's sharing history, for the report */
+typedef struct {
+	unsigned long addr;
+	long pingpongs;		/* writes by a core other than the last writer */
+	long invalidations;
+	long false_invalidations;
+	unsigned long cores;	/* bit per core that touched it */
+} BlockReport;
+
+/*
+ * make_coherence - ncores private caches like priv, over the shared
+ * cache like shared (NULL for none), all with the same block size.
+ * Returns NULL if out of memory.
+ */
+Coherence *make_coherence(int protocol, int ncores, const LevelConfig *priv,
+			  const LevelConfig *shared, unsigned long seed);
+void free_coherence(Coherence *co);
+
+/*
+ * coherent_access - Simulate one load or store by r->core; a modify is
+ * both. Returns 0 if out of memory.
+ */
+int coherent_access(Coherence *co, const Ref *r);
+
+/*
+ * worst_blocks - The n blocks (at most) that changed hands between
+ * writers most often, worst first, into out. Returns how many.
+ */
+int worst_blocks(const Coherence *co, BlockReport *out, int n);
+
+/* parse_protocol - MESI or MOESI by name; -1 if unknown */
+int parse_protocol(const char *name);
+
+#endif /* COHERENCE_H */
@@ -1,56 +1,757 @@
 /**
  * Name: Yang Wu
  * Andrew ID: yangwu
+ *
+ * csim.c - A cache simulator that replays valgrind (lackey) memory
+ * traces and counts hits, misses and evictions, matching csim-ref
+ * under the default LRU replacement. The same modules make up
+ * libcsim.a, which other programs can call (see libcsim.h), but csim
+ * isn't a wrapper over that: it runs its Hierarchies itself, since
+ * OPT's lookahead, -j, -C, -P and its reports need what the library's
+ * calls don't show.
+ *
+ * -p picks the replacement policy (see policy.c); given a list, or
+ * "all", csim runs one cache per policy side by side over a single
+ * pass of the trace and compares them. OPT needs to know when each
+ * block is used next, so with it in the list the trace is read into
+ * memory first and the lookahead computed before the replay.
+ *
+ * Instead of -s/-E/-b, a hierarchy can be given level by level with
+ * -L, closest to the CPU first (see hierarchy.c). Levels that don't
+ * name a policy use the one -p selects.
+ *
+ * -P puts a prefetcher in front of the first level (see prefetch.c).
+ * Each simulation then has a twin without one, run alongside, so the
+ * misses with and without prefetching can be set side by side with
+ * how many prefetches were issued and how many turned out useful.
+ *
+ * -j splits the sets among worker threads (see shard.c) while the main
+ * thread reads the trace. The counts are the same as a serial run's,
+ * which rules out the policies that share one random generator across
+ * sets, and the verbose output.
+ *
+ * -C simulates -N cores instead, each with a private cache like the
+ * first level, kept coherent by MESI or MOESI over the second level, if
+ * any (see coherence.c). Trace lines name their core after the size.
+ * Besides each core's counts it reports the blocks that bounced
+ * between writers most, and how many of their invalidations were
+ * false sharing.
+ *
+ * -a lists the blocks of the first level of the first simulation that
+ * missed most, with the times each was evicted, and -H writes out that
+ * level's misses and evictions set by set, for a heat map of where the
+ * conflicts are. Given tracegen's .symbols (with -y), blocks are named
+ * by the matrix element they start with, and misses are summed per
+ * matrix (see attrib.c).
+ *
+ * -c sorts that level's misses into compulsory, capacity and conflict
+ * misses by running a fully associative cache of the same size beside
+ * it (see classify.c), overall and, with -y, per matrix: conflicts call
+ * for padding, capacity misses for smaller tiles.
+ *
+ * -K adds a TLB beside the caches (see tlb.c), for 4K, 2M or 1G pages
+ * or several at once, at some level; -G maps a range of addresses with
+ * huge pages. Every access is translated once, whatever the policies,
+ * and the report has each TLB's hits and misses, the page walks and the
+ * cycles translation cost on average, taking -w cycles per page table
+ * level walked.
+ *
+ * -S simulates only one in so many groups of sets (see sample.c), the
+ * trace reader dropping the accesses to the rest on a second pass over
+ * the trace after a first has counted them, and scales the counts
+ * up to estimates for the whole cache, which it reports with their 95%
+ * confidence intervals.
+ *
+ * -R follows that level through the trace instead, writing a CSV row
+ * every -k accesses with the window's hits, misses, evictions and miss
+ * rate and a histogram of its reuse distances (see window.c), and a
+ * last row for the whole trace, to plot where the phases change.
+ *
+ * -m skips the simulation and instead measures LRU stack distances
+ * (see stackdist.c), printing the miss-ratio curve of every
+ * associativity for each number of sets listed, at block size -b.
+ *
+ * Caches are write-back and write-allocate, which is what csim-ref's
+ * counts assume. -W and -A change that for every level and turn on the
+ * write accounting: dirty evictions, the bytes they write back, the
+ * bytes stores send on down and what reaches memory, also marked per
+ * access in the verbose output.
  */
+#define _POSIX_C_SOURCE 200112L
+
 #include "cachelab.h"
+#include "hierarchy.h"
+#include "trace.h"
+#include "stackdist.h"
+#include "shard.h"
+#include "coherence.h"
+#include "attrib.h"
+#include "tlb.h"
+#include "classify.h"
+#include "sample.h"
+#include "window.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <getopt.h>
+#include <time.h>
 
-typedef struct {
-	int valid;
-	long tag;
-} Line;
+#define MAX_POLICIES 16
+#define TOP_BLOCKS 10		/* blocks in the coherence report */
+#define WINDOW 100000		/* accesses per window of -R */
 
-typedef struct {
-	Line *ptr_line;
-} Set;
+/* Mark write-backs and write-throughs in the verbose output */
+static int show_writes;
 
-int main(int argc, char **argv) {
-	Set *cache;
+/* Misses of the first simulation's first level by block and set, or NULL */
+static Attribution *attrib;
+
+/* Kinds of the misses of the first simulation's first level, or NULL */
+static Classifier *classifier;
+
+/* Counts of the first simulation's first level by window, or NULL */
+static Windows *windows;
+
+/* The sets simulated, if not all, with their first-level counts */
+static Sampler *sampler;
+
+/* Translations of every access, or NULL */
+static Tlb *tlb;
+
+/* A TLB per page size at level 1 and one for small pages at level 2 */
+static const TlbConfig default_tlbs[] = {
+	{ 1, 1 << PAGE_4K, 64, 4, 1 },
+	{ 1, 1 << PAGE_2M, 32, 4, 1 },
+	{ 1, 1 << PAGE_1G, 4, 4, 1 },
+	{ 2, 1 << PAGE_4K | 1 << PAGE_2M, 1536, 12, 7 },
+};
 
-	FILE *ptr_file;
-	
+static void usage(char *argv0)
+{
 	int i;
-	int j;
-	int s,S,b,E; //parameters for cache
-	int hit_count = 0; 
-	int miss_count = 0; 
-	int eviction_count = 0;
 
-	int verbose = 0;//use as boolean flag for verbose
-	int isMiss = 1;
+	printf("Usage: %s [-hv] [-p <policy>[,...]] [-r <seed>] -s <num> -E <num> -b <num> -t <file>\n", argv0);
+	printf("       %s [-hv] [-p <policy>[,...]] [-r <seed>] -L <level> [-L <level> ...] [-I <inclusion>] [-M <cycles>] -t <file>\n", argv0);
+	printf("       (either form also takes [-W back|through] [-A alloc|noalloc])\n");
+	printf("Options:\n");
+	printf("  -h         Print this help message.\n");
+	printf("  -v         Optional verbose flag.\n");
+	printf("  -s <num>   Number of set index bits.\n");
+	printf("  -E <num>   Number of lines per set.\n");
+	printf("  -b <num>   Number of block offset bits.\n");
+	printf("  -t <file>  Trace file, or - for standard input.\n");
+	printf("  -p <list>  Replacement policies to compare, or \"all\" (default lru).\n");
+	printf("  -r <seed>  Seed for the randomized policies (default 1).\n");
+	printf("  -L <level> A cache level, s:E:b[:latency[:policy]], L1 first.\n");
+	printf("  -I <incl>  nine, inclusive or exclusive (default nine).\n");
+	printf("  -M <num>   Memory latency in cycles (default %d).\n", MEM_LATENCY);
+	printf("  -P <pf>    Prefetcher kind[:degree[:distance]], kind next, stride or stream.\n");
+	printf("  -K <tlb>   A TLB, level:pages:entries:ways[:latency], pages 4k, 2m,\n");
+	printf("             1g or several joined by +; or \"default\".\n");
+	printf("  -G <rgn>   Map hex start:length with pages of a size, 2m or 1g.\n");
+	printf("  -w <num>   Cycles per page table level walked (default %d).\n", WALK_LATENCY);
+	printf("  -S <n>     Simulate one in n groups of sets, picked at random (see -r),\n");
+	printf("             or by hash with n:hash, and estimate the whole.\n");
+	printf("  -j <num>   Simulate on this many threads (default 1).\n");
+	printf("  -T         Report trace lines read per second on stderr.\n");
+	printf("  -C <prot>  Coherent private caches per core: mesi or moesi.\n");
+	printf("  -N <num>   Cores, with -C (default 4).\n");
+	printf("  -a <num>   List the blocks with the most misses.\n");
+	printf("  -H <file>  Write misses and evictions per set as CSV (- for stdout).\n");
+	printf("  -y <file>  Name blocks by the objects in this symbol file.\n");
+	printf("  -R <file>  Write counts and reuse distances per window as CSV.\n");
+	printf("  -k <num>   Accesses per window, with -R (default %d).\n", WINDOW);
+	printf("  -c         Count compulsory, capacity and conflict misses.\n");
+	printf("  -m <list>  Miss-ratio curves for these set index bits, with -b.\n");
+	printf("  -W <pol>   Write hits: back or through (default back).\n");
+	printf("  -A <pol>   Write misses: alloc or noalloc (default alloc).\n");
+	printf("\nPolicies:\n");
+	for(i=0; policies[i]; ++i)
+		printf("  %-9s  %s\n", policies[i]->name, policies[i]->desc);
+	printf("\nExamples:\n");
+	printf("  linux>  %s -s 4 -E 1 -b 4 -t traces/yi.trace\n", argv0);
+	printf("  linux>  %s -v -s 8 -E 2 -b 4 -t traces/yi.trace\n", argv0);
+	printf("  linux>  %s -p lru,plru,opt -s 5 -E 4 -b 5 -t traces/long.trace\n", argv0);
+	printf("  linux>  %s -L 6:8:6:4 -L 10:8:6:12 -I inclusive -t traces/long.trace\n", argv0);
+	printf("  linux>  %s -C moesi -N 2 -L 5:4:6 -L 10:16:6 -t mt.trace\n", argv0);
+	printf("  linux>  %s -P stride:2:4 -s 5 -E 4 -b 5 -t traces/long.trace\n", argv0);
+	printf("  linux>  %s -K default -G 0:ffffffffffff:2m -s 5 -E 4 -b 5 -t traces/long.trace\n", argv0);
+	printf("  linux>  %s -a 10 -y .symbols -s 5 -E 1 -b 5 -t trace.f0\n", argv0);
+	printf("  linux>  %s -c -y .symbols -s 5 -E 1 -b 5 -t trace.f0\n", argv0);
+	printf("  linux>  %s -R phases.csv -k 10000 -s 5 -E 4 -b 5 -t traces/long.trace\n", argv0);
+	printf("  linux>  %s -S 16:hash -s 10 -E 4 -b 6 -t big.trace\n", argv0);
+	printf("  linux>  %s -m 0,2,4,6 -b 5 -t traces/long.trace\n", argv0);
+}
 
-	char readLine[50];
+/* parse_policies - Fill pols from a comma separated list; returns how many */
+static int parse_policies(char *list, const Policy **pols)
+{
+	int n = 0;
+	char *name;
 
-	char opt;
-	long addr;
-	int size;
-	// tag and set from address
-	long tag;
-	int setIndex;
+	if(strcmp(list, "all") == 0) {
+		for(n=0; policies[n] && n < MAX_POLICIES; ++n)
+			pols[n] = policies[n];
+		return n;
+	}
+	for(name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+		if(n == MAX_POLICIES || (pols[n] = find_policy(name)) == NULL) {
+			fprintf(stderr, "Unknown replacement policy: %s\n", name);
+			exit(1);
+		}
+		n++;
+	}
+	return n;
+}
+
+/*
+ * parse_level - Read a level "s:E:b[:latency[:policy]]" into cfg, the
+ * latency defaulting by its depth. Returns 0 if malformed.
+ */
+static int parse_level(char *arg, int depth, LevelConfig *cfg)
+{
+	char policy[32];
+	int n;
+
+	cfg->latency = depth == 0 ? L1_LATENCY :
+		depth == 1 ? L2_LATENCY : LLC_LATENCY;
+	cfg->policy = NULL;
+	n = sscanf(arg, "%d:%d:%d:%d:%31s", &cfg->s, &cfg->E, &cfg->b,
+		   &cfg->latency, policy);
+	if(n < 3 || cfg->s < 0 || cfg->E <= 0 || cfg->b < 0 ||
+	   cfg->s + cfg->b > 63 || cfg->latency < 0)
+		return 0;
+	if(n == 5 && (cfg->policy = find_policy(policy)) == NULL) {
+		fprintf(stderr, "Unknown replacement policy: %s\n", policy);
+		exit(1);
+	}
+	return 1;
+}
+
+static void print_result(int result)
+{
+	if(result & MISS)
+		printf("miss ");
+	if(result & EVICT)
+		printf("eviction ");
+	if((result & DIRTY) && show_writes)
+		printf("writeback ");
+	if(result & HIT)
+		printf("hit ");
+	if((result & WRITE) && show_writes)
+		printf("through ");
+}
+
+/* print_levels - The results below the first level of the last access */
+static void print_levels(const Hierarchy *h)
+{
+	int k;
+
+	for(k=1; k!=h->n && h->result[k]; ++k) {
+		printf("L%d:", k+1);
+		print_result(h->result[k]);
+	}
+}
+
+/* translate - Run the accesses of a trace line through the TLBs */
+static void translate(const Ref *r)
+{
+	tlb_access(tlb, r->addr);
+	if(r->op == 'M')
+		tlb_access(tlb, r->addr);
+}
+
+/*
+ * observe - Hand the result r of an access to addr by the first
+ * simulation, h, to everything that follows it: the verbose output,
+ * the attribution, the 3C counts, the sample and the windows
+ */
+static void observe(const Hierarchy *h, unsigned long addr, int r,
+		    int verbose)
+{
+	if(verbose) {
+		print_result(r);
+		print_levels(h);
+	}
+	if(attrib && !attribute(attrib, addr, r))
+		goto oom;
+	if(classifier && !classify(classifier, addr, r))
+		goto oom;
+	if(sampler)
+		sample_count(sampler, addr, r);
+	if(windows && !window_access(windows, addr, r))
+		goto oom;
+	return;
+oom:
+	fprintf(stderr, "csim: out of memory for the miss counts\n");
+	exit(1);
+}
+
+/*
+ * replay - Run one trace line through every simulation; a modify is a
+ * load and then a store, so it takes two accesses, with next-use times
+ * next0 and next1. Verbose output follows the first simulation.
+ */
+static void replay(Hierarchy **sims, int n, const Ref *r,
+		   long next0, long next1, int verbose)
+{
+	int i, result;
+
+	if(tlb)
+		translate(r);
+	if(verbose)
+		printf("%c %lx,%d ", r->op, r->addr, r->size);
+	for(i=0; i!=n; ++i) {
+		result = access_hierarchy(sims[i], r->addr, next0,
+					  r->op == 'S', r->size);
+		if(i == 0)
+			observe(sims[i], r->addr, result, verbose);
+		if(r->op == 'M') {
+			result = access_hierarchy(sims[i], r->addr, next1,
+						  1, r->size);
+			if(i == 0)
+				observe(sims[i], r->addr, result, verbose);
+		}
+	}
+	if(verbose)
+		printf("\n");
+}
+
+/* deal - Queue a trace line for the workers, as replay runs it */
+static void deal(Shards *sh, const Ref *r, long next0, long next1)
+{
+	if(tlb)
+		translate(r);
+	shard_access(sh, r->addr, next0, r->op == 'S', r->size);
+	if(r->op == 'M')
+		shard_access(sh, r->addr, next1, 1, r->size);
+}
+
+/* print_hierarchy - Per-level counts and the AMAT of one simulation */
+static void print_hierarchy(const Hierarchy *h)
+{
+	int k;
+
+	printf("%-6s %10s %10s %10s %10s %9s\n", "level",
+	       "hits", "misses", "evictions", "back-inv", "miss-rate");
+	for(k=0; k!=h->n; ++k) {
+		const Cache *c = h->levels[k];
+		long total = c->hits + c->misses;
+		printf("L%-5d %10ld %10ld %10ld %10ld %8.2f%%\n", k+1,
+		       c->hits, c->misses, c->evictions, h->backinvals[k],
+		       total ? 100.0 * c->misses / total : 0.0);
+	}
+	printf("memory accesses: %ld, AMAT: %.2f cycles\n",
+	       h->mem_accesses, amat(h));
+}
+
+/*
+ * print_prefetch - First-level misses of each simulation in sims, which
+ * prefetched, next to those of its twin in base, which didn't
+ */
+static void print_prefetch(Hierarchy **sims, Hierarchy **base,
+			   const Policy **pols, int n, const PrefetchConfig *pf)
+{
+	int i;
+
+	printf("prefetch: %s, degree %d, distance %d\n",
+	       prefetch_name(pf->kind), pf->degree, pf->distance);
+	printf("%-9s %10s %11s %9s %10s %10s %10s %9s\n", "policy", "misses",
+	       "no-prefetch", "coverage", "issued", "useful", "useless",
+	       "accuracy");
+	for(i=0; i!=n; ++i) {
+		const Hierarchy *h = sims[i];
+		long m = h->levels[0]->misses, m0 = base[i]->levels[0]->misses;
+		printf("%-9s %10ld %11ld %8.2f%% %10ld %10ld %10ld %8.2f%%\n",
+		       pols[i]->name, m, m0, m0 ? 100.0 * (m0 - m) / m0 : 0.0,
+		       h->pf_issued, h->pf_useful, h->pf_useless,
+		       h->pf_issued ? 100.0 * h->pf_useful / h->pf_issued : 0.0);
+	}
+}
+
+/* print_writes - Write traffic out of each level and into memory */
+static void print_writes(const Hierarchy *h)
+{
+	int k;
+
+	printf("%-6s %10s %12s %12s\n", "level",
+	       "dirty-evict", "wb-bytes", "wt-bytes");
+	for(k=0; k!=h->n; ++k) {
+		const Cache *c = h->levels[k];
+		printf("L%-5d %10ld %12ld %12ld\n", k+1, c->dirty_evictions,
+		       c->dirty_evictions << c->b, h->through_bytes[k]);
+	}
+	printf("memory: %ld bytes read, %ld bytes written\n",
+	       h->mem_accesses << h->levels[h->n-1]->b, h->mem_write_bytes);
+}
+
+/* parse_sets - Fill s from a comma separated list; returns how many */
+static int parse_sets(char *list, int *s)
+{
+	int n = 0;
+	char *v;
+
+	for(v = strtok(list, ","); v; v = strtok(NULL, ",")) {
+		if(n == MAX_GEOMETRIES || (s[n] = atoi(v)) < 0 || s[n] > 30) {
+			printf("Bad or too many set index bits: %s\n", v);
+			exit(1);
+		}
+		n++;
+	}
+	return n;
+}
+
+/*
+ * miss_curve - One pass over the trace, then the LRU misses for each
+ * number of sets and each associativity up to the one that leaves
+ * only cold misses.
+ */
+static void miss_curve(Trace *t, int b, int *s, int n)
+{
+	StackDist *sd;
+	Ref r;
+	long E, misses, total;
+	int k;
+
+	if((sd = make_stackdist(b, s, n)) == NULL) {
+		fprintf(stderr, "csim: out of memory for the stack distances\n");
+		exit(1);
+	}
+	while(next_ref(t, &r)) {
+		if(!stackdist_access(sd, r.addr) ||
+		   (r.op == 'M' && !stackdist_access(sd, r.addr))) {
+			fprintf(stderr, "csim: out of memory for the stack distances\n");
+			exit(1);
+		}
+	}
+
+	total = stackdist_accesses(sd);
+	printf("%6s %8s %12s %10s %9s\n", "sets", "ways", "bytes",
+	       "misses", "miss-rate");
+	for(k=0; k!=n; ++k) {
+		for(E=1; ; E*=2) {
+			misses = stackdist_misses(sd, k, E);
+			printf("%6ld %8ld %12ld %10ld %8.2f%%\n", 1L << s[k], E,
+			       (E << s[k]) << b, misses,
+			       total ? 100.0 * misses / total : 0.0);
+			if(E >= stackdist_ways(sd, k))
+				break;
+		}
+	}
+	free_stackdist(sd);
+}
+
+/* print_cores - The cores, by number, whose bits are set in mask */
+static void print_cores(unsigned long mask)
+{
+	int i, sep = 0;
+
+	for(i=0; i!=MAX_CORES; ++i) {
+		if(mask & 1UL << i) {
+			printf("%s%d", sep ? "," : "", i);
+			sep = 1;
+		}
+	}
+}
+
+/*
+ * run_coherent - Replay a trace tagged by core on ncores private caches
+ * like levels[0], over levels[1] if there is one, and report
+ */
+static void run_coherent(Trace *t, int protocol, int ncores,
+			 const LevelConfig *levels, int nlevels,
+			 unsigned long seed)
+{
+	Coherence *co;
+	BlockReport worst[TOP_BLOCKS];
+	Ref r;
+	long hits = 0, misses = 0, evictions = 0, upgrades = 0;
+	int i, n;
+
+	co = make_coherence(protocol, ncores, &levels[0],
+			    nlevels > 1 ? &levels[1] : NULL, seed);
+	if(!co) {
+		fprintf(stderr, "csim: out of memory for the caches\n");
+		exit(1);
+	}
+	while(next_ref(t, &r)) {
+		if(r.core == MAX_CORES) {
+			printf("csim: Core %d or more at line %ld of the trace\n",
+			       MAX_CORES, trace_lines(t));
+			exit(1);
+		}
+		if(r.core >= ncores) {
+			printf("csim: Core %d at line %ld of the trace, but only %d cores\n",
+			       r.core, trace_lines(t), ncores);
+			exit(1);
+		}
+		if(!coherent_access(co, &r)) {
+			fprintf(stderr, "csim: out of memory for the directory\n");
+			exit(1);
+		}
+	}
+
+	printf("%-5s %10s %10s %10s %10s %10s %10s\n", "core", "hits", "misses",
+	       "coh-miss", "upgrades", "inval-in", "c2c-in");
+	for(i=0; i!=ncores; ++i) {
+		const Cache *c = co->cores[i];
+		const CoreStats *st = &co->stats[i];
+		printf("%-5d %10ld %10ld %10ld %10ld %10ld %10ld\n", i, c->hits,
+		       c->misses, st->coherence_misses, st->upgrades,
+		       st->invalidated, st->transfers_in);
+		hits += c->hits;
+		misses += c->misses;
+		evictions += c->evictions;
+		upgrades += st->upgrades;
+	}
+	printf("bus: %ld reads, %ld read-exclusives, %ld upgrades\n",
+	       co->bus_reads, co->bus_read_excl, upgrades);
+	printf("invalidations: %ld, false sharing: %ld\n",
+	       co->invalidations, co->false_invalidations);
+	printf("cache-to-cache transfers: %ld, write-backs: %ld\n",
+	       co->transfers, co->writebacks);
+	if(co->shared)
+		printf("shared: %ld hits, %ld misses, %ld evictions\n",
+		       co->shared->hits, co->shared->misses, co->shared->evictions);
+	printf("memory: %ld blocks read, %ld written\n",
+	       co->mem_reads, co->mem_writes);
+
+	if((n = worst_blocks(co, worst, TOP_BLOCKS)) > 0) {
+		printf("\n%-18s %10s %10s %10s  %s\n", "block", "ping-pong",
+		       "invals", "false", "cores");
+		for(i=0; i!=n; ++i) {
+			printf("%-18lx %10ld %10ld %10ld  ", worst[i].addr,
+			       worst[i].pingpongs, worst[i].invalidations,
+			       worst[i].false_invalidations);
+			print_cores(worst[i].cores);
+			if(2 * worst[i].false_invalidations > worst[i].invalidations)
+				printf("  false sharing");
+			printf("\n");
+		}
+	}
+	printSummary(hits, misses, evictions);
+	free_coherence(co);
+}
+
+/*
+ * print_attribution - The top blocks of cache c by misses, misses per
+ * object, and the per-set counts to the file heatmap, as asked
+ */
+static void print_attribution(const Cache *c, int top, const Symbols *sy,
+			      const char *heatmap)
+{
+	BlockCounts *blocks;
+	const long *acc, *miss, *evict;
+	long *smiss, *sevict;
+	char name[64];
+	FILE *fp;
+	long i, S;
+	int n;
+
+	if(top > 0) {
+		if(!(blocks = malloc(top * sizeof(BlockCounts)))) {
+			fprintf(stderr, "csim: out of memory for the report\n");
+			exit(1);
+		}
+		n = top_blocks(attrib, blocks, top);
+		printf("%-18s %8s %10s %10s  %s\n", "block", "set", "misses",
+		       "evictions", "object");
+		for(i=0; i!=n; ++i) {
+			symbolize(sy, blocks[i].addr, name, sizeof(name));
+			printf("%-18lx %8ld %10ld %10ld  %s\n", blocks[i].addr,
+			       (blocks[i].addr >> c->b) & (c->S - 1), blocks[i].misses,
+			       blocks[i].evictions, name);
+		}
+		free(blocks);
+	}
+	if(sy) {
+		n = nsymbols(sy);
+		smiss = malloc((n ? n : 1) * sizeof(long));
+		sevict = malloc((n ? n : 1) * sizeof(long));
+		if(!smiss || !sevict) {
+			fprintf(stderr, "csim: out of memory for the report\n");
+			exit(1);
+		}
+		symbol_counts(attrib, sy, smiss, sevict);
+		printf("%-18s %10s %10s\n", "object", "misses", "evictions");
+		for(i=0; i!=n; ++i)
+			printf("%-18s %10ld %10ld\n", symbol_name(sy, i),
+			       smiss[i], sevict[i]);
+		free(smiss);
+		free(sevict);
+	}
+	if(heatmap) {
+		if(strcmp(heatmap, "-") == 0)
+			fp = stdout;
+		else if((fp = fopen(heatmap, "w")) == NULL) {
+			perror(heatmap);
+			exit(1);
+		}
+		S = set_counts(attrib, &acc, &miss, &evict);
+		fprintf(fp, "set,accesses,misses,evictions\n");
+		for(i=0; i!=S; ++i)
+			fprintf(fp, "%ld,%ld,%ld,%ld\n", i, acc[i], miss[i], evict[i]);
+		if(fp != stdout)
+			fclose(fp);
+	}
+}
+
+/* print_tlb - Each TLB's counts, the page walks and the cost of it all */
+static void print_tlb(const Tlb *t)
+{
+	char pages[16];
+	long total;
+	int i, k;
+
+	printf("%-6s %-9s %7s %5s %10s %10s %9s\n", "tlb", "pages",
+	       "entries", "ways", "hits", "misses", "miss-rate");
+	for(i=0; i!=t->n; ++i) {
+		const Cache *c = t->tlbs[i];
+		pages[0] = '\0';
+		for(k=0; k!=PAGE_SIZES; ++k) {
+			if(!(t->cfg[i].pages & 1 << k))
+				continue;
+			if(pages[0])
+				strcat(pages, "+");
+			strcat(pages, page_name(k));
+		}
+		total = c->hits + c->misses;
+		printf("L%-5d %-9s %7d %5d %10ld %10ld %8.2f%%\n", t->cfg[i].level,
+		       pages, t->cfg[i].entries, t->cfg[i].ways, c->hits, c->misses,
+		       total ? 100.0 * c->misses / total : 0.0);
+	}
+	printf("translations: %ld, page walks: %ld (4k %ld, 2m %ld, 1g %ld)\n",
+	       t->accesses, t->walks[PAGE_4K] + t->walks[PAGE_2M] + t->walks[PAGE_1G],
+	       t->walks[PAGE_4K], t->walks[PAGE_2M], t->walks[PAGE_1G]);
+	printf("translation cost: %.0f cycles, %.2f per access\n", t->cycles,
+	       t->accesses ? t->cycles / t->accesses : 0.0);
+}
+
+/* print_sample - How much was simulated, and the first level's estimates */
+static void print_sample(const Sampler *sp, int hashed)
+{
+	static const char *const names[ESTIMATES] = { "hits", "misses", "evictions" };
+	double est, bound;
+	long picked, groups;
+	int k, strata;
+
+	sample_groups(sp, &picked, &groups, &strata);
+	printf("sampled %ld of %ld set groups in %d strata (%s)\n", picked,
+	       groups, strata, hashed ? "by hash" : "at random");
+	printf("%-10s %14s %14s\n", "estimate", "value", "95% bound");
+	for(k=0; k!=ESTIMATES; ++k) {
+		sample_estimate(sp, k, &est, &bound);
+		printf("%-10s %14.0f %14.0f\n", names[k], est, bound);
+	}
+	sample_miss_rate(sp, &est, &bound);
+	printf("%-10s %13.3f%% %13.3f%%\n", "miss-rate", 100 * est, 100 * bound);
+}
+
+/* print_kinds - The misses of each kind, in all and per object of sy */
+static void print_kinds(const Classifier *cl, const Symbols *sy)
+{
+	long kinds[MISS_KINDS];
+	int i, k, n = sy ? nsymbols(sy) : 0;
+
+	printf("%-18s %10s", "object", "misses");
+	for(k=0; k!=MISS_KINDS; ++k)
+		printf(" %10s", miss_kind_name(k));
+	printf("\n");
+	for(i = -1; i != n; ++i) {
+		miss_kinds(cl, i, kinds);
+		printf("%-18s %10ld", i < 0 ? "all" : symbol_name(sy, i),
+		       kinds[COMPULSORY] + kinds[CAPACITY] + kinds[CONFLICT]);
+		for(k=0; k!=MISS_KINDS; ++k)
+			printf(" %10ld", kinds[k]);
+		printf("\n");
+	}
+}
+
+/*
+ * load_trace - Read the whole trace into *refsp, with the block address
+ * of every access (two for a modify) in *blocksp. Returns the number of
+ * lines and sets *naccp to the number of accesses.
+ */
+static long load_trace(Trace *t, int b, Ref **refsp,
+		       unsigned long **blocksp, long *naccp)
+{
+	Ref *refs = NULL;
+	unsigned long *blocks = NULL;
+	long n = 0, nacc = 0, max = 0;
+	Ref r;
+
+	while(next_ref(t, &r)) {
+		if(n == max) {
+			max = max ? 2 * max : 4096;
+			refs = realloc(refs, max * sizeof(Ref));
+			blocks = realloc(blocks, 2 * max * sizeof(unsigned long));
+			if(!refs || !blocks) {
+				fprintf(stderr, "csim: out of memory for the trace\n");
+				exit(1);
+			}
+		}
+		refs[n++] = r;
+		blocks[nacc++] = r.addr >> b;
+		if(r.op == 'M')
+			blocks[nacc++] = r.addr >> b;
+	}
+	*refsp = refs;
+	*blocksp = blocks;
+	*naccp = nacc;
+	return n;
+}
+
+int main(int argc, char **argv) {
+	Hierarchy *sims[MAX_POLICIES * MAX_THREADS];
+	const Policy *pols[MAX_POLICIES];
+	LevelConfig levels[MAX_LEVELS], cfg[MAX_LEVELS];
+	int npols = 0, nlevels = 0, nsims;
+	PrefetchConfig pf;
+	int prefetching = 0;
+	int inclusion = NINE, mem_latency = MEM_LATENCY;
+	int write_through = 0, no_write_allocate = 0;
+	int lookahead = 0;
+	unsigned long seed = 1;
+	int curve[MAX_GEOMETRIES], ncurve = 0;
+	int nthreads = 1;
+	int protocol = -1, ncores = 4;
+	int top = 0, kinds = 0;
+	char *heatmap = NULL;
+	Symbols *syms = NULL;
+	Shards *sh = NULL;
+	TlbConfig tlbs[MAX_TLBS];
+	Region regions[MAX_REGIONS];
+	int ntlbs = 0, nregions = 0, walk_latency = WALK_LATENCY;
+	int pages;
+	int rate = 0, hashed = 0;
+	char *phases = NULL;
+	long window = WINDOW;
+	FILE *phases_fp = NULL;
+	char *opt;
+
+	Trace *trace = NULL;
+	char *trace_path = NULL;
+	int timing = 0;
+	struct timespec t0, t1;
+	double secs;
+
+	int s = -1, E = -1, b = -1; //parameters for cache
+	int verbose = 0;//use as boolean flag for verbose
+	int i, k, w;
+
+	Ref r;
 
 	int c;
-	while((c=getopt(argc,argv,"vs:E:b:t:"))!=-1) {
+	while((c=getopt(argc,argv,"hvs:E:b:t:p:r:L:I:M:W:A:Tm:j:C:N:a:H:y:cP:K:G:w:S:R:k:"))!=-1) {
 		switch(c) {
 			case 'v':
 				verbose = 1;
 				break;
 			case 's':
 				s = atoi(optarg);
-				S = 1<<s; //S = 2^s
 				break;
 			case 'E':
 				E = atoi(optarg);
@@ -59,122 +760,451 @@ int main(int argc, char **argv) {
 				b = atoi(optarg);
 				break;
 			case 't':
-				ptr_file = fopen(optarg, "r");
+				trace_path = optarg;
+				if((trace = open_trace(optarg)) == NULL) {
+					perror(optarg);
+					exit(1);
+				}
 				break;
-			default:
-				return 0;
-		}
-	}
-
-	cache = (Set *)malloc(S * sizeof(Set));
-	for(i=0; i!=S; ++i) {
-		cache[i].ptr_line = (Line *)malloc(E * sizeof(Line));
-		for(j=0; j!=E; ++j) {
-			cache[i].ptr_line[j].valid = 0;
-		}
-	}
-
-	while(fgets(readLine, 50, ptr_file)){
-		sscanf(readLine,"%c %lx,%d",&opt,&addr,&size);
-		tag = addr & (-1<<(b+s));
-		setIndex = (addr>>b)&(S-1);
-		switch(opt){
-			case 'M':
-				if(verbose){
-					printf("%c %lx,%d", opt, addr, size);
+			case 'T':
+				timing = 1;
+				break;
+			case 'j':
+				nthreads = atoi(optarg);
+				if(nthreads < 1 || nthreads > MAX_THREADS) {
+					printf("%s: Threads must be 1 to %d\n", argv[0], MAX_THREADS);
+					exit(1);
+				}
+				break;
+			case 'C':
+				if((protocol = parse_protocol(optarg)) < 0) {
+					printf("%s: Unknown coherence protocol: %s\n", argv[0], optarg);
+					exit(1);
+				}
+				break;
+			case 'N':
+				ncores = atoi(optarg);
+				if(ncores < 1 || ncores > MAX_CORES) {
+					printf("%s: Cores must be 1 to %d\n", argv[0], MAX_CORES);
+					exit(1);
 				}
-				isMiss = 1;
-				for(i=0; i!=E && isMiss; ++i){
-					if(cache[setIndex].ptr_line[i].valid && cache[setIndex].ptr_line[i].tag == tag) {
-						isMiss = 0;
-						hit_count += 2;
-						for(j=1; j!=i+1; ++j){
-							cache[setIndex].ptr_line[i-j+1].valid = cache[setIndex].ptr_line[i-j].valid;
-							cache[setIndex].ptr_line[i-j+1].tag = cache[setIndex].ptr_line[i-j].tag;
-						}
-						cache[setIndex].ptr_line[0].valid = 1;
-						cache[setIndex].ptr_line[0].tag = tag;
-						if(verbose){
-							printf("hit hit\n");
-						}
-					}
+				break;
+			case 'P':
+				if(!parse_prefetch(optarg, &pf)) {
+					printf("%s: Bad prefetcher: %s\n", argv[0], optarg);
+					exit(1);
 				}
-				if(isMiss){
-					hit_count++;
-					miss_count++;
-					if(verbose){
-						printf("miss");
-					}
-					if(cache[setIndex].ptr_line[E-1].valid){
-						eviction_count++;
-						if(verbose){
-							printf("eviction");
-						}
-					}
-					for(i=1; i!=E; ++i){
-						cache[setIndex].ptr_line[E-i].valid = cache[setIndex].ptr_line[E-i-1].valid;
-						cache[setIndex].ptr_line[E-i].tag = cache[setIndex].ptr_line[E-i-1].tag; 
-					}
-					cache[setIndex].ptr_line[0].valid = 1;
-					cache[setIndex].ptr_line[0].tag = tag;
-					if(verbose){
-						printf("hit\n");
-					}
+				prefetching = 1;
+				break;
+			case 'K':
+				if(strcmp(optarg, "default") == 0) {
+					for(k=0; k!=sizeof(default_tlbs) / sizeof(default_tlbs[0]) &&
+						 ntlbs != MAX_TLBS; ++k)
+						tlbs[ntlbs++] = default_tlbs[k];
 					break;
 				}
-			case 'L':
+				if(ntlbs == MAX_TLBS || !parse_tlb(optarg, &tlbs[ntlbs])) {
+					printf("%s: Bad TLB: %s\n", argv[0], optarg);
+					exit(1);
+				}
+				ntlbs++;
+				break;
+			case 'G':
+				if(nregions == MAX_REGIONS ||
+				   !parse_region(optarg, &regions[nregions])) {
+					printf("%s: Bad page region: %s\n", argv[0], optarg);
+					exit(1);
+				}
+				nregions++;
+				break;
+			case 'w':
+				walk_latency = atoi(optarg);
+				break;
 			case 'S':
-				if(verbose){
-					printf("%c %lx,%d", opt, addr, size);
+				rate = strtol(optarg, &opt, 10);
+				hashed = strcmp(opt, ":hash") == 0;
+				if(rate < 1 || (*opt && !hashed)) {
+					printf("%s: Bad sampling: %s\n", argv[0], optarg);
+					exit(1);
+				}
+				break;
+			case 'a':
+				top = atoi(optarg);
+				break;
+			case 'H':
+				heatmap = optarg;
+				break;
+			case 'c':
+				kinds = 1;
+				break;
+			case 'R':
+				phases = optarg;
+				break;
+			case 'k':
+				if((window = atol(optarg)) < 1) {
+					printf("%s: Bad window: %s\n", argv[0], optarg);
+					exit(1);
+				}
+				break;
+			case 'y':
+				if((syms = load_symbols(optarg)) == NULL) {
+					perror(optarg);
+					exit(1);
 				}
-				isMiss = 1;
-				for(i=0; i!=E && isMiss; ++i){
-					if(cache[setIndex].ptr_line[i].valid && cache[setIndex].ptr_line[i].tag == tag){
-						isMiss = 0;
-						hit_count++;
-						for(j=1; j!=i+1; ++j){
-							cache[setIndex].ptr_line[i-j+1].valid = cache[setIndex].ptr_line[i-j].valid;
-							cache[setIndex].ptr_line[i-j+1].tag = cache[setIndex].ptr_line[i-j].tag;
-						}
-						cache[setIndex].ptr_line[0].valid = 1;
-						cache[setIndex].ptr_line[0].tag = tag;
-						if(verbose){
-							printf("hit\n");
-						}
-					}
+				break;
+			case 'm':
+				ncurve = parse_sets(optarg, curve);
+				break;
+			case 'p':
+				npols = parse_policies(optarg, pols);
+				break;
+			case 'r':
+				seed = strtoul(optarg, NULL, 0);
+				break;
+			case 'L':
+				if(nlevels == MAX_LEVELS ||
+				   !parse_level(optarg, nlevels, &levels[nlevels])) {
+					printf("%s: Bad cache level: %s\n", argv[0], optarg);
+					exit(1);
+				}
+				nlevels++;
+				break;
+			case 'I':
+				if((inclusion = parse_inclusion(optarg)) < 0) {
+					printf("%s: Unknown inclusion policy: %s\n", argv[0], optarg);
+					exit(1);
+				}
+				break;
+			case 'M':
+				mem_latency = atoi(optarg);
+				break;
+			case 'W':
+				if(strcmp(optarg, "back") && strcmp(optarg, "through")) {
+					printf("%s: Unknown write policy: %s\n", argv[0], optarg);
+					exit(1);
 				}
-				if(isMiss){
-					miss_count++;
-					if(verbose){
-						printf("miss");
-					}
-					if(cache[setIndex].ptr_line[E-1].valid){
-						eviction_count++;
-						if(verbose){
-							printf("eviction\n");
-						}
-					}
-					for(i=1; i!=E; ++i){
-						cache[setIndex].ptr_line[E-i].valid = cache[setIndex].ptr_line[E-i-1].valid;
-						cache[setIndex].ptr_line[E-i].tag = cache[setIndex].ptr_line[E-i-1].tag; 
-					}
-					cache[setIndex].ptr_line[0].valid = 1;
-					cache[setIndex].ptr_line[0].tag = tag;
-					printf("\n");
+				write_through = strcmp(optarg, "through") == 0;
+				show_writes = 1;
+				break;
+			case 'A':
+				if(strcmp(optarg, "alloc") && strcmp(optarg, "noalloc")) {
+					printf("%s: Unknown write-miss policy: %s\n", argv[0], optarg);
+					exit(1);
 				}
+				no_write_allocate = strcmp(optarg, "noalloc") == 0;
+				show_writes = 1;
 				break;
+			case 'h':
+				usage(argv[0]);
+				exit(0);
 			default:
-				;
+				usage(argv[0]);
+				exit(1);
+		}
+	}
+
+	if((nlevels == 0 && !ncurve && (s < 0 || E <= 0 || b < 0 || s + b > 63)) ||
+	   (ncurve && (b < 0 || b > 63)) || trace == NULL) {
+		printf("%s: Missing required command line argument\n", argv[0]);
+		usage(argv[0]);
+		exit(1);
+	}
+	if((rate || phases) && (ncurve || protocol >= 0)) {
+		printf("%s: -S and -R can't go with -m or -C\n", argv[0]);
+		exit(1);
+	}
+	if((ntlbs || nregions) && (ncurve || protocol >= 0)) {
+		printf("%s: -K and -G can't go with -m or -C\n", argv[0]);
+		exit(1);
+	}
+	if(ncurve) {
+		miss_curve(trace, b, curve, ncurve);
+		close_trace(trace);
+		return 0;
+	}
+	if(nlevels == 0) {
+		levels[0].s = s;
+		levels[0].E = E;
+		levels[0].b = b;
+		levels[0].latency = L1_LATENCY;
+		levels[0].policy = NULL;
+		nlevels = 1;
+	}
+	if(npols == 0)
+		pols[npols++] = find_policy("lru");
+
+	if(protocol >= 0) {
+		if(nlevels > 2 || npols > 1 || verbose || show_writes || nthreads > 1 ||
+		   prefetching || (nlevels == 2 && levels[1].b != levels[0].b)) {
+			printf("%s: -C takes one policy, a private and perhaps a shared "
+			       "level with the same block size, and no -v, -W, -A, -P or -j\n",
+			       argv[0]);
+			exit(1);
+		}
+		for(k=0; k!=nlevels; ++k)
+			if(!levels[k].policy)
+				levels[k].policy = pols[0];
+		run_coherent(trace, protocol, ncores, levels, nlevels, seed);
+		close_trace(trace);
+		return 0;
+	}
+
+	if(prefetching && (inclusion == EXCLUSIVE || nthreads > 1)) {
+		/* a shard would train on part of the access stream only */
+		printf("%s: -P can't go with exclusive levels or -j\n", argv[0]);
+		exit(1);
+	}
+	/* the twins without prefetching follow the simulations proper */
+	nsims = prefetching ? 2 * npols : npols;
+	for(i=0; i!=npols; ++i) {
+		for(k=0; k!=nlevels; ++k) {
+			cfg[k] = levels[k];
+			cfg[k].write_through = write_through;
+			cfg[k].no_write_allocate = no_write_allocate;
+			if(!cfg[k].policy)
+				cfg[k].policy = pols[i];
+			if(strcmp(cfg[k].policy->name, "opt") == 0)
+				lookahead = 1;
+			/* one generator per cache: its draws depend on every set */
+			if(nthreads > 1 && (strcmp(cfg[k].policy->name, "random") == 0 ||
+					    strcmp(cfg[k].policy->name, "brrip") == 0)) {
+				printf("%s: %s can't be split over threads\n", argv[0],
+				       cfg[k].policy->name);
+				exit(1);
 			}
 		}
-		 printSummary(hit_count, miss_count, eviction_count);
+		for(w=0; w!=nthreads; ++w) {
+			if((sims[w*nsims + i] = make_hierarchy(cfg, nlevels, inclusion,
+							       mem_latency, seed)) == NULL) {
+				fprintf(stderr, "%s: out of memory for the cache\n", argv[0]);
+				exit(1);
+			}
+		}
+		if(prefetching &&
+		   (!set_prefetcher(sims[i], &pf) ||
+		    (sims[npols + i] = make_hierarchy(cfg, nlevels, inclusion,
+						      mem_latency, seed)) == NULL)) {
+			fprintf(stderr, "%s: out of memory for the cache\n", argv[0]);
+			exit(1);
+		}
+	}
+	for(k=1; k!=nlevels; ++k) {
+		/* exclusive levels trade blocks; OPT looks ahead by L1 block */
+		if((inclusion == EXCLUSIVE || lookahead) && levels[k].b != levels[0].b) {
+			printf("%s: %s needs the same block size at every level\n",
+			       argv[0], lookahead ? "opt" : "exclusive");
+			exit(1);
+		}
+	}
+	if(nthreads > 1) {
+		if(verbose) {
+			printf("%s: -v can't be split over threads\n", argv[0]);
+			exit(1);
+		}
+		if(nthreads > max_shards(sims[0])) {
+			printf("%s: These sets split %d ways at most\n", argv[0],
+			       max_shards(sims[0]));
+			exit(1);
+		}
+	}
 
-		for(i=0; i!=S; ++i){
-			free(cache[i].ptr_line);
+	if(top > 0 || heatmap || syms || kinds) {
+		if(nthreads > 1) {
+			printf("%s: -a, -H, -y and -c can't be split over threads\n", argv[0]);
+			exit(1);
 		}
+		/* with -c the misses per object are broken down by kind instead */
+		if((top > 0 || heatmap || (syms && !kinds)) &&
+		   (attrib = make_attribution(sims[0]->levels[0])) == NULL) {
+			fprintf(stderr, "%s: out of memory for the miss counts\n", argv[0]);
+			exit(1);
+		}
+		if(kinds &&
+		   (classifier = make_classifier(sims[0]->levels[0], syms)) == NULL) {
+			fprintf(stderr, "%s: out of memory for the miss counts\n", argv[0]);
+			exit(1);
+		}
+	}
 
-		free(cache);
-		fclose(ptr_file);
-		return 0;
-	
-}
\ No newline at end of file
+	if(phases) {
+		if(nthreads > 1 || rate) {
+			printf("%s: -R can't go with -j or -S\n", argv[0]);
+			exit(1);
+		}
+		if(strcmp(phases, "-") == 0)
+			phases_fp = stdout;
+		else if((phases_fp = fopen(phases, "w")) == NULL) {
+			perror(phases);
+			exit(1);
+		}
+		if((windows = make_windows(levels[0].b, window, phases_fp)) == NULL) {
+			fprintf(stderr, "%s: out of memory for the windows\n", argv[0]);
+			exit(1);
+		}
+	}
+	if(rate) {
+		/* these need every access, or the counts of every set */
+		if(nthreads > 1 || prefetching || kinds || ntlbs || nregions || verbose) {
+			printf("%s: -S can't go with -j, -P, -c, -K, -G or -v\n", argv[0]);
+			exit(1);
+		}
+		if(strcmp(trace_path, "-") == 0) {
+			printf("%s: -S reads the trace twice, so not from stdin\n", argv[0]);
+			exit(1);
+		}
+		if((sampler = make_sampler(sims[0], rate, hashed, seed)) == NULL) {
+			if(errno)
+				fprintf(stderr, "%s: out of memory for the sample\n", argv[0]);
+			else
+				printf("%s: Too few sets to pick one in %d\n", argv[0], rate);
+			exit(1);
+		}
+		if(!sample_plan(sampler, trace)) {
+			fprintf(stderr, "%s: out of memory for the sample\n", argv[0]);
+			exit(1);
+		}
+		close_trace(trace);
+		if((trace = open_trace(trace_path)) == NULL) {
+			perror(trace_path);
+			exit(1);
+		}
+		sample_filter(sampler, trace);
+	}
+	if(ntlbs || nregions) {
+		/* each page size in use needs somewhere to be cached */
+		pages = 1 << PAGE_4K;
+		for(k=0; k!=nregions; ++k)
+			pages |= 1 << regions[k].page;
+		for(k=0; k!=ntlbs; ++k)
+			pages &= ~tlbs[k].pages;
+		if(pages) {
+			printf("%s: No TLB holds the %s pages\n", argv[0],
+			       page_name(__builtin_ctz(pages)));
+			exit(1);
+		}
+		if((tlb = make_tlb(tlbs, ntlbs, regions, nregions,
+				   walk_latency)) == NULL) {
+			fprintf(stderr, "%s: out of memory for the TLBs\n", argv[0]);
+			exit(1);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if(nthreads > 1 && (sh = start_shards(sims, nsims, nthreads)) == NULL) {
+		fprintf(stderr, "%s: can't start the threads\n", argv[0]);
+		exit(1);
+	}
+	if(lookahead) {
+		Ref *refs;
+		unsigned long *blocks;
+		long *next;
+		long n, nacc, j, a = 0;
+
+		n = load_trace(trace, levels[0].b, &refs, &blocks, &nacc);
+		if((next = next_uses(blocks, nacc)) == NULL) {
+			fprintf(stderr, "%s: out of memory for the lookahead\n", argv[0]);
+			exit(1);
+		}
+		for(j=0; j!=n; ++j) {
+			if(sh)
+				deal(sh, &refs[j], next[a],
+				     refs[j].op == 'M' ? next[a+1] : NEVER);
+			else
+				replay(sims, nsims, &refs[j], next[a],
+				       refs[j].op == 'M' ? next[a+1] : NEVER, verbose);
+			a += refs[j].op == 'M' ? 2 : 1;
+		}
+		free(next);
+		free(blocks);
+		free(refs);
+	} else {
+		while(next_ref(trace, &r)) {
+			if(sh)
+				deal(sh, &r, NEVER, NEVER);
+			else
+				replay(sims, nsims, &r, NEVER, NEVER, verbose);
+		}
+	}
+	if(sh)
+		finish_shards(sh);
+	if(sampler)
+		for(i=0; i!=nsims; ++i)
+			scale_hierarchy(sims[i], sample_factor(sampler),
+					sample_accesses(sampler));
+	if(windows) {
+		finish_windows(windows);
+		if(phases_fp != stdout)
+			fclose(phases_fp);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if(timing) {
+		secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+		fprintf(stderr, "%ld lines in %.3f s, %.0f lines/s\n",
+			trace_lines(trace), secs,
+			secs > 0 ? trace_lines(trace) / secs : 0.0);
+	}
+
+	if(nlevels > 1) {
+		for(i=0; i!=npols; ++i) {
+			if(npols > 1)
+				printf("%s[%s]\n", i ? "\n" : "", pols[i]->name);
+			print_hierarchy(sims[i]);
+		}
+	} else if(npols > 1) {
+		printf("%-9s %10s %10s %10s %9s\n",
+		       "policy", "hits", "misses", "evictions", "miss-rate");
+		for(i=0; i!=npols; ++i) {
+			const Cache *l1 = sims[i]->levels[0];
+			long total = l1->hits + l1->misses;
+			printf("%-9s %10ld %10ld %10ld %8.2f%%\n", pols[i]->name,
+			       l1->hits, l1->misses, l1->evictions,
+			       total ? 100.0 * l1->misses / total : 0.0);
+		}
+	}
+	if(show_writes) {
+		for(i=0; i!=npols; ++i) {
+			if(npols > 1)
+				printf("%s[%s]\n", i || nlevels > 1 ? "\n" : "",
+				       pols[i]->name);
+			print_writes(sims[i]);
+		}
+	}
+	if(prefetching) {
+		if(nlevels > 1 || npols > 1 || show_writes)
+			printf("\n");
+		print_prefetch(sims, sims + npols, pols, npols, &pf);
+	}
+	if(attrib) {
+		print_attribution(sims[0]->levels[0], top, syms, heatmap);
+		free_attribution(attrib);
+	}
+	if(classifier) {
+		if(nlevels > 1 || npols > 1 || show_writes || prefetching || attrib)
+			printf("\n");
+		print_kinds(classifier, syms);
+		free_classifier(classifier);
+	}
+	if(sampler) {
+		if(nlevels > 1 || npols > 1 || show_writes || attrib)
+			printf("\n");
+		print_sample(sampler, hashed);
+		free_sampler(sampler);
+	}
+	if(tlb) {
+		if(nlevels > 1 || npols > 1 || show_writes || prefetching || attrib ||
+		   classifier)
+			printf("\n");
+		print_tlb(tlb);
+		free_tlb(tlb);
+	}
+	printSummary(sims[0]->levels[0]->hits, sims[0]->levels[0]->misses,
+		     sims[0]->levels[0]->evictions);
+
+	for(i=0; i!=nsims * nthreads; ++i)
+		free_hierarchy(sims[i]);
+	if(syms)
+		free_symbols(syms);
+	close_trace(trace);
+	return 0;
+}
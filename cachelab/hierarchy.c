@@ -0,0 +1,347 @@
+/*
+ * hierarchy.c - A hierarchy of caches in front of memory
+ *
+ * An access looks in each level in turn until one hits, paying each
+ * level's latency on the way down, and memory's if they all miss. What
+ * happens to the block and to the victims on the way back depends on
+ * the inclusion policy (see hierarchy.h).
+ */
+#include "hierarchy.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+Hierarchy *make_hierarchy(const LevelConfig *cfg, int n, int inclusion,
+			  int mem_latency, unsigned long seed)
+{
+	Hierarchy *h = calloc(1, sizeof(Hierarchy));
+	int i;
+
+	if(!h)
+		return NULL;
+	h->n = n;
+	h->inclusion = inclusion;
+	h->mem_latency = mem_latency;
+	for(i=0; i!=n; ++i) {
+		h->latency[i] = cfg[i].latency;
+		h->levels[i] = make_cache(cfg[i].s, cfg[i].E, cfg[i].b,
+					  cfg[i].policy, seed);
+		if(!h->levels[i]) {
+			h->n = i;
+			free_hierarchy(h);
+			return NULL;
+		}
+		h->levels[i]->write_through = cfg[i].write_through;
+		h->levels[i]->no_write_allocate = cfg[i].no_write_allocate;
+	}
+	return h;
+}
+
+void free_hierarchy(Hierarchy *h)
+{
+	int i;
+
+	for(i=0; i!=h->n; ++i)
+		free_cache(h->levels[i]);
+	if(h->pf)
+		free_prefetcher(h->pf);
+	free(h);
+}
+
+int set_prefetcher(Hierarchy *h, const PrefetchConfig *cfg)
+{
+	Cache *l1 = h->levels[0];
+
+	h->pf = make_prefetcher(cfg, l1->b, l1->S * l1->E);
+	return h->pf != NULL;
+}
+
+/*
+ * write_down - A write of bytes at addr leaves the level above k: the
+ * first write-back level from k down that holds the block keeps it,
+ * and otherwise it goes to memory. Write-backs don't allocate.
+ */
+static void write_down(Hierarchy *h, int k, unsigned long addr, long bytes)
+{
+	for(; k < h->n; ++k)
+		if(update_cache(h->levels[k], addr))
+			return;
+	h->mem_write_bytes += bytes;
+}
+
+/*
+ * back_invalidate - Level k evicted the block at h->levels[k]->evicted;
+ * drop every part of it from the levels above, writing back what's
+ * dirty there past level k.
+ */
+static void back_invalidate(Hierarchy *h, int k)
+{
+	unsigned long base = h->levels[k]->evicted;
+	unsigned long addr, end = base + (1UL << h->levels[k]->b);
+	int j, r;
+
+	for(j=0; j!=k; ++j) {
+		unsigned long step = 1UL << h->levels[j]->b;
+		for(addr = base; addr < end; addr += step) {
+			if((r = invalidate_cache(h->levels[j], addr))) {
+				h->backinvals[j]++;
+				if(j == 0 && h->pf && prefetch_clear(h->pf, addr))
+					h->pf_useless++;
+			}
+			if(r & DIRTY)
+				write_down(h, k+1, addr, step);
+		}
+	}
+}
+
+/* evicted - Deal with the eviction that access result r of level k made */
+static void evicted(Hierarchy *h, int k, int r)
+{
+	Cache *c = h->levels[k];
+
+	if(h->inclusion == INCLUSIVE && k > 0)
+		back_invalidate(h, k);
+	if(r & DIRTY)
+		write_down(h, k+1, c->evicted, 1L << c->b);
+}
+
+/*
+ * prefetch - Bring the block at addr into the first level from the
+ * first level below that has it, or from memory, filling the levels
+ * in between as a load miss would
+ */
+static void prefetch(Hierarchy *h, unsigned long addr)
+{
+	int k, r;
+
+	if(probe_cache(h->levels[0], addr))
+		return;
+	for(k=1; k!=h->n && !probe_cache(h->levels[k], addr); ++k)
+		;
+	if(k == h->n)
+		h->mem_accesses++;
+	h->pf_issued++;
+	while(k-- > 0) {
+		r = fill_cache(h->levels[k], addr, NEVER, 0);
+		if(r & EVICT) {
+			if(k == 0 && prefetch_clear(h->pf, h->levels[0]->evicted))
+				h->pf_useless++;
+			evicted(h, k, r);
+		}
+	}
+	prefetch_mark(h->pf, addr);
+}
+
+/*
+ * train - Show the prefetcher the access to addr just made, and fetch
+ * what it asks for. A hit on a prefetched block is its first use, and
+ * triggers prefetching like a miss.
+ */
+static void train(Hierarchy *h, unsigned long addr)
+{
+	unsigned long want[MAX_DEGREE];
+	int r = h->result[0], trigger = (r & MISS) != 0;
+	int i, n;
+
+	if((r & EVICT) && prefetch_clear(h->pf, h->levels[0]->evicted))
+		h->pf_useless++;
+	if((r & HIT) && prefetch_clear(h->pf, addr)) {
+		h->pf_useful++;
+		trigger = 1;
+	}
+	n = prefetch_train(h->pf, addr, trigger, want);
+	for(i=0; i!=n; ++i)
+		prefetch(h, want[i]);
+}
+
+/*
+ * access_exclusive - The first level is an ordinary cache. A block found
+ * lower down leaves that level for the first, dirty or not, and victims
+ * drop one level at a time until one arrives at a set with room or
+ * falls out of the last level.
+ */
+static int access_exclusive(Hierarchy *h, unsigned long addr, long next,
+			    int write, int size)
+{
+	Cache *c, *l1 = h->levels[0];
+	int k, r, result;
+
+	h->cycles += h->latency[0];
+	result = h->result[0] = access_cache(l1, addr, next, write);
+	if(result & WRITE) {
+		h->through_bytes[0] += size;
+		write_down(h, 1, addr, size);
+	}
+	if((result & HIT) || !probe_cache(l1, addr))
+		return result;
+
+	for(k=1; k!=h->n; ++k) {
+		c = h->levels[k];
+		h->cycles += h->latency[k];
+		if((r = invalidate_cache(c, addr))) {
+			c->hits++;
+			h->result[k] = HIT;
+			if((r & DIRTY) && !update_cache(l1, addr))
+				h->mem_write_bytes += 1L << c->b;
+			break;
+		}
+		c->misses++;
+		h->result[k] = MISS;
+	}
+	if(k == h->n) {
+		h->cycles += h->mem_latency;
+		h->mem_accesses++;
+	}
+
+	/* pass the victims down */
+	for(k=0; k!=h->n && (h->result[k] & EVICT); ++k) {
+		c = h->levels[k];
+		if(k+1 == h->n) {
+			if(h->result[k] & DIRTY)
+				h->mem_write_bytes += 1L << c->b;
+			break;
+		}
+		h->result[k+1] |= fill_cache(h->levels[k+1], c->evicted, NEVER,
+					     (h->result[k] & DIRTY) != 0);
+	}
+	return result;
+}
+
+int access_hierarchy(Hierarchy *h, unsigned long addr, long next,
+		     int write, int size)
+{
+	Cache *c;
+	int k, r;
+	int through = -1;	/* level whose store goes on after the fill */
+
+	h->accesses++;
+	memset(h->result, 0, sizeof(h->result));
+	if(h->inclusion == EXCLUSIVE)
+		return access_exclusive(h, addr, next, write, size);
+
+	for(k=0; k!=h->n; ++k) {
+		c = h->levels[k];
+		h->cycles += h->latency[k];
+		r = h->result[k] = access_cache(c, addr, next, write);
+		if(r & EVICT)
+			evicted(h, k, r);
+		if(r & WRITE) {
+			h->through_bytes[k] += size;
+			if(r & HIT) {
+				write_down(h, k+1, addr, size);
+				break;
+			}
+			/* a store that allocated fetches the block as a load */
+			if(!c->no_write_allocate) {
+				write = 0;
+				if(through < 0)
+					through = k;
+			}
+		} else if(write) {
+			write = 0;	/* stored in a write-back line */
+		}
+		if(r & HIT)
+			break;
+	}
+	if(k == h->n) {
+		h->cycles += h->mem_latency;
+		if(write)
+			h->mem_write_bytes += size;
+		else
+			h->mem_accesses++;
+	}
+	if(through >= 0)
+		write_down(h, through+1, addr, size);
+	if(h->pf)
+		train(h, addr);
+	return h->result[0];
+}
+
+void merge_hierarchy(Hierarchy *dst, const Hierarchy *src)
+{
+	int k;
+
+	for(k=0; k!=dst->n; ++k) {
+		Cache *d = dst->levels[k];
+		const Cache *c = src->levels[k];
+		d->hits += c->hits;
+		d->misses += c->misses;
+		d->evictions += c->evictions;
+		d->dirty_evictions += c->dirty_evictions;
+		dst->backinvals[k] += src->backinvals[k];
+		dst->through_bytes[k] += src->through_bytes[k];
+	}
+	dst->accesses += src->accesses;
+	dst->mem_accesses += src->mem_accesses;
+	dst->mem_write_bytes += src->mem_write_bytes;
+	dst->cycles += src->cycles;
+	dst->pf_issued += src->pf_issued;
+	dst->pf_useful += src->pf_useful;
+	dst->pf_useless += src->pf_useless;
+}
+
+/* scale - n times f, rounded */
+static long scale(long n, double f)
+{
+	return (long)(n * f + 0.5);
+}
+
+void scale_hierarchy(Hierarchy *h, double f, long accesses)
+{
+	Cache *l1 = h->levels[0];
+	long hits;
+	int k;
+
+	for(k=0; k!=h->n; ++k) {
+		Cache *c = h->levels[k];
+		c->hits = scale(c->hits, f);
+		c->misses = scale(c->misses, f);
+		c->evictions = scale(c->evictions, f);
+		c->dirty_evictions = scale(c->dirty_evictions, f);
+		h->backinvals[k] = scale(h->backinvals[k], f);
+		h->through_bytes[k] = scale(h->through_bytes[k], f);
+	}
+	h->mem_accesses = scale(h->mem_accesses, f);
+	h->mem_write_bytes = scale(h->mem_write_bytes, f);
+	h->cycles *= f;
+	h->pf_issued = scale(h->pf_issued, f);
+	h->pf_useful = scale(h->pf_useful, f);
+	h->pf_useless = scale(h->pf_useless, f);
+
+	/* every access that didn't miss in L1 hit there */
+	hits = accesses > l1->misses ? accesses - l1->misses : 0;
+	h->cycles += (double)(hits - l1->hits) * h->latency[0];
+	l1->hits = hits;
+	h->accesses = accesses;
+}
+
+int set_key_bits(const Hierarchy *h, int *shift)
+{
+	int k, lo = 64;
+
+	*shift = 0;
+	for(k=0; k!=h->n; ++k) {
+		const Cache *c = h->levels[k];
+		if(c->b > *shift)
+			*shift = c->b;
+		if(c->b + c->s < lo)
+			lo = c->b + c->s;
+	}
+	return lo > *shift ? lo - *shift : 0;
+}
+
+double amat(const Hierarchy *h)
+{
+	return h->accesses ? h->cycles / h->accesses : 0.0;
+}
+
+int parse_inclusion(const char *name)
+{
+	if(strcmp(name, "nine") == 0)
+		return NINE;
+	if(strcmp(name, "inclusive") == 0)
+		return INCLUSIVE;
+	if(strcmp(name, "exclusive") == 0)
+		return EXCLUSIVE;
+	return -1;
+}
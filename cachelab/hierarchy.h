@@ -0,0 +1,109 @@
+/*
+ * hierarchy.h - A hierarchy of caches in front of memory
+ */
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include "cache.h"
+#include "prefetch.h"
+
+#define MAX_LEVELS 8
+
+/* Default latencies in cycles: L1, L2, L3 and below, and memory */
+#define L1_LATENCY  4
+#define L2_LATENCY  12
+#define LLC_LATENCY 40
+#define MEM_LATENCY 200
+
+/*
+ * How the contents of the levels relate.
+ * NINE: neither inclusive nor exclusive; every level a miss reaches
+ *     gets the block, and evicts on its own.
+ * INCLUSIVE: the same, except that a block evicted from a level is
+ *     invalidated in the levels above it (a back-invalidation).
+ * EXCLUSIVE: a block is in one level at most. Misses fill only the
+ *     first level, a hit lower down moves the block up, and each level
+ *     passes its victims to the next.
+ */
+enum { NINE, INCLUSIVE, EXCLUSIVE };
+
+typedef struct {
+	int s, E, b;
+	int latency;		/* cycles to look in the level */
+	const Policy *policy;
+	int write_through;	/* as in Cache */
+	int no_write_allocate;
+} LevelConfig;
+
+typedef struct {
+	int n;
+	int inclusion;
+	int mem_latency;
+	Cache *levels[MAX_LEVELS];
+	int latency[MAX_LEVELS];
+	long backinvals[MAX_LEVELS];	/* lines invalidated from below */
+	long through_bytes[MAX_LEVELS];	/* store bytes passed on down */
+	int result[MAX_LEVELS];		/* of the last access, 0 if not reached */
+	long accesses;
+	long mem_accesses;		/* blocks read from memory */
+	long mem_write_bytes;		/* bytes written to memory */
+	double cycles;
+	Prefetcher *pf;			/* at the first level, or NULL */
+	long pf_issued;			/* blocks prefetched */
+	long pf_useful;			/* used before they were evicted */
+	long pf_useless;		/* evicted unused */
+} Hierarchy;
+
+/*
+ * make_hierarchy - Levels cfg[0..n-1], the first closest to the CPU.
+ * Returns NULL if out of memory.
+ */
+Hierarchy *make_hierarchy(const LevelConfig *cfg, int n, int inclusion,
+			  int mem_latency, unsigned long seed);
+void free_hierarchy(Hierarchy *h);
+
+/*
+ * set_prefetcher - Prefetch into the first level. Prefetches are filled
+ * like load misses but counted apart, and aren't on any access's
+ * critical path. Not for exclusive hierarchies. Returns 0 if out of
+ * memory.
+ */
+int set_prefetcher(Hierarchy *h, const PrefetchConfig *cfg);
+
+/*
+ * access_hierarchy - Simulate one load or store (write set) of size
+ * bytes at addr (next as for access_cache). Returns the first level's
+ * result; h->result has the others.
+ */
+int access_hierarchy(Hierarchy *h, unsigned long addr, long next,
+		     int write, int size);
+
+/*
+ * merge_hierarchy - Add the counts of src, which has the same levels,
+ * to those of dst
+ */
+void merge_hierarchy(Hierarchy *dst, const Hierarchy *src);
+
+/*
+ * scale_hierarchy - Multiply every count by f, to stand for the whole
+ * trace when only a sample of the sets was simulated, except that the
+ * accesses, known exactly, are set to accesses and the first level's
+ * hits made up from them: hits crowd into few sets far more than
+ * misses do, so scaling them is the least reliable estimate
+ */
+void scale_hierarchy(Hierarchy *h, double f, long accesses);
+
+/*
+ * set_key_bits - How many address bits, from *shift up, are part of the
+ * set index at every level; accesses that differ in them never meet in
+ * any set
+ */
+int set_key_bits(const Hierarchy *h, int *shift);
+
+/* amat - Average memory access time so far, in cycles */
+double amat(const Hierarchy *h);
+
+/* parse_inclusion - NINE, INCLUSIVE or EXCLUSIVE by name; -1 if unknown */
+int parse_inclusion(const char *name);
+
+#endif /* HIERARCHY_H */
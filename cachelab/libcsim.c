@@ -0,0 +1,165 @@
+/*
+ * libcsim.c - The cache simulator as a library
+ *
+ * A Csim is a Hierarchy and the level configs it was made from, so a
+ * reset can make it anew rather than every module having to know how
+ * to empty itself. Accesses go to access_hierarchy as csim's replay
+ * sends them, which keeps the counts the same as csim's for the same
+ * trace and config.
+ *
+ * Only the csim_ calls are global in libcsim.a: the Makefile links the
+ * modules into one object and makes every other symbol local to it,
+ * so the library's internals can't clash with a caller's names.
+ */
+#include "libcsim.h"
+#include "hierarchy.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+struct Csim {
+	Hierarchy *h;
+	LevelConfig cfg[MAX_LEVELS];
+	int n, inclusion, mem_latency;
+	unsigned long seed;
+};
+
+/* The results csim_access returns are the cache's own */
+#if CSIM_HIT != HIT || CSIM_MISS != MISS || CSIM_EVICT != EVICT
+#error "libcsim.h and cache.h disagree on the results"
+#endif
+#if CSIM_MAX_LEVELS > MAX_LEVELS
+#error "libcsim.h allows more levels than a Hierarchy has"
+#endif
+
+Csim *csim_create(const CsimConfig *cfg)
+{
+	Csim *sim;
+	const CsimLevel *lv;
+	int k;
+
+	if(cfg->nlevels < 1 || cfg->nlevels > CSIM_MAX_LEVELS)
+		goto bad;
+	if(!(sim = calloc(1, sizeof(Csim))))
+		return NULL;
+	sim->n = cfg->nlevels;
+	sim->inclusion = cfg->inclusion ? parse_inclusion(cfg->inclusion) : NINE;
+	sim->mem_latency = cfg->mem_latency ? cfg->mem_latency : MEM_LATENCY;
+	sim->seed = cfg->seed ? cfg->seed : 1;
+	if(sim->inclusion < 0)
+		goto bad_sim;
+	for(k=0; k!=sim->n; ++k) {
+		lv = &cfg->levels[k];
+		if(lv->s < 0 || lv->E <= 0 || lv->b < 0 || lv->s + lv->b > 63 ||
+		   lv->latency < 0)
+			goto bad_sim;
+		/* exclusive levels trade whole blocks */
+		if(sim->inclusion == EXCLUSIVE && lv->b != cfg->levels[0].b)
+			goto bad_sim;
+		sim->cfg[k].s = lv->s;
+		sim->cfg[k].E = lv->E;
+		sim->cfg[k].b = lv->b;
+		sim->cfg[k].latency = lv->latency ? lv->latency :
+			k == 0 ? L1_LATENCY : k == 1 ? L2_LATENCY : LLC_LATENCY;
+		sim->cfg[k].policy = find_policy(lv->policy ? lv->policy : "lru");
+		if(!sim->cfg[k].policy || sim->cfg[k].policy == find_policy("opt"))
+			goto bad_sim;
+		sim->cfg[k].write_through = cfg->write_through;
+		sim->cfg[k].no_write_allocate = cfg->no_write_allocate;
+	}
+	if(!(sim->h = make_hierarchy(sim->cfg, sim->n, sim->inclusion,
+				     sim->mem_latency, sim->seed))) {
+		free(sim);
+		errno = ENOMEM;
+		return NULL;
+	}
+	return sim;
+bad_sim:
+	free(sim);
+bad:
+	errno = EINVAL;
+	return NULL;
+}
+
+void csim_destroy(Csim *sim)
+{
+	free_hierarchy(sim->h);
+	free(sim);
+}
+
+int csim_access(Csim *sim, unsigned long addr, int size, char op)
+{
+	int r;
+
+	if(op != 'L' && op != 'S' && op != 'M') {
+		errno = EINVAL;
+		return -1;
+	}
+	r = access_hierarchy(sim->h, addr, NEVER, op == 'S', size);
+	if(op == 'M')
+		access_hierarchy(sim->h, addr, NEVER, 1, size);
+	return r & (HIT | MISS | EVICT);
+}
+
+long csim_access_many(Csim *sim, const CsimAccess *acc, long n)
+{
+	long i, misses = 0;
+	int r;
+
+	for(i=0; i!=n; ++i) {
+		if((r = csim_access(sim, acc[i].addr, acc[i].size, acc[i].op)) < 0)
+			return -1;
+		misses += (r & MISS) != 0;
+	}
+	return misses;
+}
+
+long csim_replay(Csim *sim, const char *path)
+{
+	Trace *t;
+	Ref r;
+	long n = 0;
+
+	if(!(t = open_trace(path)))
+		return -1;
+	while(next_ref(t, &r)) {
+		csim_access(sim, r.addr, r.size, r.op);
+		n++;
+	}
+	close_trace(t);
+	return n;
+}
+
+void csim_stats(const Csim *sim, CsimStats *st)
+{
+	const Hierarchy *h = sim->h;
+	int k;
+
+	st->nlevels = h->n;
+	for(k=0; k!=h->n; ++k) {
+		st->levels[k].hits = h->levels[k]->hits;
+		st->levels[k].misses = h->levels[k]->misses;
+		st->levels[k].evictions = h->levels[k]->evictions;
+		st->levels[k].dirty_evictions = h->levels[k]->dirty_evictions;
+		st->levels[k].back_invalidations = h->backinvals[k];
+	}
+	st->accesses = h->accesses;
+	st->mem_accesses = h->mem_accesses;
+	st->mem_write_bytes = h->mem_write_bytes;
+	st->amat = amat(h);
+}
+
+int csim_reset(Csim *sim)
+{
+	Hierarchy *h = make_hierarchy(sim->cfg, sim->n, sim->inclusion,
+				      sim->mem_latency, sim->seed);
+
+	if(!h) {
+		errno = ENOMEM;
+		return -1;
+	}
+	free_hierarchy(sim->h);
+	sim->h = h;
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * libcsim.h - The cache simulator as a library
+ *
+ * csim's caches, for programs that want to simulate their own accesses
+ * without writing a trace and running csim on it:
+ *
+ *     CsimConfig cfg = { 1, { { 5, 1, 5 } } };
+ *     Csim *sim = csim_create(&cfg);
+ *     csim_access(sim, addr, 4, 'L');
+ *     ...
+ *     csim_stats(sim, &st);
+ *
+ * Link with libcsim.a. This header is all a caller needs.
+ */
+#ifndef LIBCSIM_H
+#define LIBCSIM_H
+
+#define CSIM_MAX_LEVELS 8
+
+/* One cache level */
+typedef struct {
+	int s, E, b;		/* 2^s sets of E lines of 2^b bytes */
+	int latency;		/* cycles to look in it; 0 for the default */
+	const char *policy;	/* replacement, as csim -p; NULL for lru */
+} CsimLevel;
+
+/*
+ * A hierarchy, the first level closest to the CPU. Zero is the default
+ * for everything else: no inclusion policy ("nine"), memory latency as
+ * csim's, write-back, write-allocate, seed 1.
+ */
+typedef struct {
+	int nlevels;
+	CsimLevel levels[CSIM_MAX_LEVELS];
+	const char *inclusion;	/* "nine", "inclusive" or "exclusive" */
+	int mem_latency;
+	int write_through;
+	int no_write_allocate;
+	unsigned long seed;	/* for the randomized policies */
+} CsimConfig;
+
+/* Results of an access at the first level, as in csim -v */
+#define CSIM_HIT   1
+#define CSIM_MISS  2
+#define CSIM_EVICT 4
+
+/* An access: op 'L' for a load, 'S' a store, 'M' a load then a store */
+typedef struct {
+	unsigned long addr;
+	int size;
+	char op;
+} CsimAccess;
+
+typedef struct {
+	long hits, misses, evictions;
+	long dirty_evictions;		/* each wrote back a block */
+	long back_invalidations;	/* by an inclusive level below */
+} CsimLevelStats;
+
+typedef struct {
+	int nlevels;
+	CsimLevelStats levels[CSIM_MAX_LEVELS];
+	long accesses;
+	long mem_accesses;		/* blocks read from memory */
+	long mem_write_bytes;
+	double amat;			/* cycles */
+} CsimStats;
+
+typedef struct Csim Csim;
+
+/*
+ * csim_create - Empty caches as cfg says. Returns NULL with errno
+ * EINVAL if cfg is bad (OPT needs the future, so it is refused) or
+ * ENOMEM if out of memory.
+ */
+Csim *csim_create(const CsimConfig *cfg);
+void csim_destroy(Csim *sim);
+
+/*
+ * csim_access - Simulate one access of size bytes at addr. Returns its
+ * result at the first level (for a modify, the load's; the store then
+ * hits), or -1 with errno EINVAL for an unknown op.
+ */
+int csim_access(Csim *sim, unsigned long addr, int size, char op);
+
+/*
+ * csim_access_many - Simulate n accesses in order. Returns how many of
+ * them missed at the first level, or -1 at the first unknown op.
+ */
+long csim_access_many(Csim *sim, const CsimAccess *acc, long n);
+
+/*
+ * csim_replay - Simulate the data accesses of the trace at path, text
+ * or binary, as csim -t would. Returns how many, or -1 with errno set
+ * if the trace can't be read.
+ */
+long csim_replay(Csim *sim, const char *path);
+
+/* csim_stats - The counts so far, into *st */
+void csim_stats(const Csim *sim, CsimStats *st);
+
+/*
+ * csim_reset - Empty the caches and zero the counts. Returns -1, with
+ * sim as it was, if out of memory.
+ */
+int csim_reset(Csim *sim);
+
+#endif /* LIBCSIM_H */
@@ -0,0 +1,595 @@
+/*
+ * policy.c - Replacement policies for the cache simulator
+ *
+ * Ways are numbered 0..E-1 within a set; line i of the cache is way
+ * i % E of set i / E. Policies that have to search a set (bit-PLRU,
+ * RRIP, LFU, OPT) do so in O(E), as the hardware does in parallel;
+ * LRU, FIFO, random and tree-PLRU are O(1) or O(log E) per access.
+ */
+#include "policy.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NIL (-1)
+
+/* xorshift64* - a small seeded generator, so random runs repeat */
+static unsigned long next_random(unsigned long *x)
+{
+	*x ^= *x >> 12;
+	*x ^= *x << 25;
+	*x ^= *x >> 27;
+	return *x * 0x2545F4914F6CDD1DUL;
+}
+
+/*
+ * LRU and FIFO: each set keeps its lines in a doubly linked list from
+ * the most recently used (or filled) to the least. FIFO just doesn't
+ * move a line when it hits.
+ */
+typedef struct {
+	int E;
+	int on_hit;		/* move hits to the front: LRU */
+	int *prev, *next;	/* per line */
+	int *head, *tail;	/* per set */
+} ListState;
+
+static void *list_create(long S, int E, int on_hit)
+{
+	ListState *st = calloc(1, sizeof(ListState));
+	long i;
+
+	if(!st)
+		return NULL;
+	st->E = E;
+	st->on_hit = on_hit;
+	st->prev = malloc(S * E * sizeof(int));
+	st->next = malloc(S * E * sizeof(int));
+	st->head = malloc(S * sizeof(int));
+	st->tail = malloc(S * sizeof(int));
+	if(!st->prev || !st->next || !st->head || !st->tail) {
+		free(st->prev);
+		free(st->next);
+		free(st->head);
+		free(st->tail);
+		free(st);
+		return NULL;
+	}
+	for(i=0; i!=S; ++i)
+		st->head[i] = st->tail[i] = NIL;
+	return st;
+}
+
+static void *lru_create(long S, int E, unsigned long seed)
+{
+	(void)seed;
+	return list_create(S, E, 1);
+}
+
+static void *fifo_create(long S, int E, unsigned long seed)
+{
+	(void)seed;
+	return list_create(S, E, 0);
+}
+
+static void list_destroy(void *p)
+{
+	ListState *st = p;
+
+	free(st->prev);
+	free(st->next);
+	free(st->head);
+	free(st->tail);
+	free(st);
+}
+
+static void list_unlink(ListState *st, long set, int i)
+{
+	if(st->prev[i] != NIL)
+		st->next[st->prev[i]] = st->next[i];
+	else
+		st->head[set] = st->next[i];
+	if(st->next[i] != NIL)
+		st->prev[st->next[i]] = st->prev[i];
+	else
+		st->tail[set] = st->prev[i];
+}
+
+static void list_push(ListState *st, long set, int i)
+{
+	st->prev[i] = NIL;
+	st->next[i] = st->head[set];
+	if(st->head[set] != NIL)
+		st->prev[st->head[set]] = i;
+	else
+		st->tail[set] = i;
+	st->head[set] = i;
+}
+
+static void list_hit(void *p, long set, int way, long next)
+{
+	ListState *st = p;
+	int i = (int)(set * st->E) + way;
+
+	(void)next;
+	if(st->on_hit && st->head[set] != i) {
+		list_unlink(st, set, i);
+		list_push(st, set, i);
+	}
+}
+
+static void list_fill(void *p, long set, int way, long next)
+{
+	ListState *st = p;
+
+	(void)next;
+	list_push(st, set, (int)(set * st->E) + way);
+}
+
+static void list_drop(void *p, long set, int way)
+{
+	ListState *st = p;
+
+	list_unlink(st, set, (int)(set * st->E) + way);
+}
+
+/* The victim leaves the list here; its fill puts it back at the front */
+static int list_victim(void *p, long set)
+{
+	ListState *st = p;
+	int i = st->tail[set];
+
+	list_unlink(st, set, i);
+	return i - (int)(set * st->E);
+}
+
+/* Random: any way of the set */
+typedef struct {
+	int E;
+	unsigned long x;
+} RandomState;
+
+static void *random_create(long S, int E, unsigned long seed)
+{
+	RandomState *st = malloc(sizeof(RandomState));
+
+	(void)S;
+	if(!st)
+		return NULL;
+	st->E = E;
+	st->x = seed ? seed : 1;
+	return st;
+}
+
+static void nop(void *p, long set, int way, long next)
+{
+	(void)p; (void)set; (void)way; (void)next;
+}
+
+static int random_victim(void *p, long set)
+{
+	RandomState *st = p;
+
+	(void)set;
+	return (int)(next_random(&st->x) % st->E);
+}
+
+/*
+ * Tree-PLRU: a binary tree over the ways whose node bits point towards
+ * the half to evict from next; an access turns the bits on its path
+ * away from it. Nodes are heap-numbered from 1 with the P leaves (P the
+ * power of two at or above E) at P..2P-1. When E isn't a power of two
+ * the missing leaves are on the right and the walk steers around them.
+ */
+typedef struct {
+	int E, P;
+	unsigned char *bits;	/* P per set; [0] is unused */
+} TreeState;
+
+static void *tree_create(long S, int E, unsigned long seed)
+{
+	TreeState *st = malloc(sizeof(TreeState));
+
+	(void)seed;
+	if(!st)
+		return NULL;
+	st->E = E;
+	for(st->P = 1; st->P < E; st->P <<= 1)
+		;
+	if(!(st->bits = calloc(S * st->P, 1))) {
+		free(st);
+		return NULL;
+	}
+	return st;
+}
+
+static void tree_destroy(void *p)
+{
+	TreeState *st = p;
+
+	free(st->bits);
+	free(st);
+}
+
+static void tree_touch(void *p, long set, int way, long next)
+{
+	TreeState *st = p;
+	unsigned char *bits = st->bits + set * st->P;
+	int n;
+
+	(void)next;
+	for(n = st->P + way; n > 1; n >>= 1)
+		bits[n >> 1] = !(n & 1);
+}
+
+static int tree_victim(void *p, long set)
+{
+	TreeState *st = p;
+	unsigned char *bits = st->bits + set * st->P;
+	int n = 1, lo;
+
+	while(n < st->P) {
+		n = 2*n + bits[n];
+		/* a subtree past the last way: take its sibling */
+		for(lo = n; lo < st->P; lo <<= 1)
+			;
+		if(lo - st->P >= st->E)
+			n ^= 1;
+	}
+	return n - st->P;
+}
+
+/*
+ * Bit-PLRU (MRU bits): an access sets its line's bit, and when that
+ * would set them all, the others are cleared. The victim is the first
+ * way whose bit is clear.
+ */
+typedef struct {
+	int E;
+	unsigned char *mru;	/* per line */
+	int *count;		/* bits set, per set */
+} BitState;
+
+static void *bit_create(long S, int E, unsigned long seed)
+{
+	BitState *st = malloc(sizeof(BitState));
+
+	(void)seed;
+	if(!st)
+		return NULL;
+	st->E = E;
+	st->mru = calloc(S * E, 1);
+	st->count = calloc(S, sizeof(int));
+	if(!st->mru || !st->count) {
+		free(st->mru);
+		free(st->count);
+		free(st);
+		return NULL;
+	}
+	return st;
+}
+
+static void bit_destroy(void *p)
+{
+	BitState *st = p;
+
+	free(st->mru);
+	free(st->count);
+	free(st);
+}
+
+static void bit_touch(void *p, long set, int way, long next)
+{
+	BitState *st = p;
+	unsigned char *mru = st->mru + set * st->E;
+	int i;
+
+	(void)next;
+	if(mru[way])
+		return;
+	if(st->count[set] + 1 == st->E && st->E > 1) {
+		for(i=0; i!=st->E; ++i)
+			mru[i] = 0;
+		st->count[set] = 0;
+	}
+	mru[way] = 1;
+	st->count[set]++;
+}
+
+static void bit_drop(void *p, long set, int way)
+{
+	BitState *st = p;
+
+	if(st->mru[set * st->E + way]) {
+		st->mru[set * st->E + way] = 0;
+		st->count[set]--;
+	}
+}
+
+static int bit_victim(void *p, long set)
+{
+	BitState *st = p;
+	unsigned char *mru = st->mru + set * st->E;
+	int i;
+
+	for(i=0; i!=st->E; ++i)
+		if(!mru[i])
+			break;
+	return i == st->E ? 0 : i;	/* all set only with E == 1 */
+}
+
+/*
+ * SRRIP and BRRIP (Jaleel et al., ISCA 2010) with 2-bit re-reference
+ * predictions: 0 is near, 3 distant. Hits predict near; SRRIP fills at
+ * 2 and BRRIP at 3 but for one fill in 32. The victim is a line at 3,
+ * after ageing the whole set until there is one.
+ */
+#define RRPV_MAX 3
+#define BRRIP_NEAR 32
+
+typedef struct {
+	int E;
+	int bimodal;
+	unsigned long x;
+	unsigned char *rrpv;	/* per line */
+} RripState;
+
+static void *rrip_create(long S, int E, unsigned long seed, int bimodal)
+{
+	RripState *st = malloc(sizeof(RripState));
+
+	if(!st)
+		return NULL;
+	st->E = E;
+	st->bimodal = bimodal;
+	st->x = seed ? seed : 1;
+	if(!(st->rrpv = calloc(S * E, 1))) {
+		free(st);
+		return NULL;
+	}
+	return st;
+}
+
+static void *srrip_create(long S, int E, unsigned long seed)
+{
+	return rrip_create(S, E, seed, 0);
+}
+
+static void *brrip_create(long S, int E, unsigned long seed)
+{
+	return rrip_create(S, E, seed, 1);
+}
+
+static void rrip_destroy(void *p)
+{
+	RripState *st = p;
+
+	free(st->rrpv);
+	free(st);
+}
+
+static void rrip_hit(void *p, long set, int way, long next)
+{
+	RripState *st = p;
+
+	(void)next;
+	st->rrpv[set * st->E + way] = 0;
+}
+
+static void rrip_fill(void *p, long set, int way, long next)
+{
+	RripState *st = p;
+	int v = RRPV_MAX - 1;
+
+	(void)next;
+	if(st->bimodal && next_random(&st->x) % BRRIP_NEAR != 0)
+		v = RRPV_MAX;
+	st->rrpv[set * st->E + way] = v;
+}
+
+static int rrip_victim(void *p, long set)
+{
+	RripState *st = p;
+	unsigned char *rrpv = st->rrpv + set * st->E;
+	int i, oldest = 0;
+
+	for(i=0; i!=st->E; ++i)
+		if(rrpv[i] > rrpv[oldest])
+			oldest = i;
+	/* age the set by as much as it takes to bring one line to 3 */
+	if(rrpv[oldest] != RRPV_MAX) {
+		int age = RRPV_MAX - rrpv[oldest];
+		for(i=0; i!=st->E; ++i)
+			rrpv[i] += age;
+	}
+	return oldest;
+}
+
+/*
+ * LFU: evict the line with the fewest accesses since it was filled,
+ * the least recently used of those if there's a tie. OPT shares the
+ * per-line key: it evicts the line whose next use is furthest off.
+ */
+typedef struct {
+	int E;
+	long clock;
+	long *key;		/* per line: count (LFU) or next use (OPT) */
+	long *stamp;		/* per line: time of last access */
+} KeyState;
+
+static void *key_create(long S, int E, unsigned long seed)
+{
+	KeyState *st = calloc(1, sizeof(KeyState));
+
+	(void)seed;
+	if(!st)
+		return NULL;
+	st->E = E;
+	st->key = calloc(S * E, sizeof(long));
+	st->stamp = calloc(S * E, sizeof(long));
+	if(!st->key || !st->stamp) {
+		free(st->key);
+		free(st->stamp);
+		free(st);
+		return NULL;
+	}
+	return st;
+}
+
+static void key_destroy(void *p)
+{
+	KeyState *st = p;
+
+	free(st->key);
+	free(st->stamp);
+	free(st);
+}
+
+static void lfu_hit(void *p, long set, int way, long next)
+{
+	KeyState *st = p;
+	long i = set * st->E + way;
+
+	(void)next;
+	st->key[i]++;
+	st->stamp[i] = ++st->clock;
+}
+
+static void lfu_fill(void *p, long set, int way, long next)
+{
+	KeyState *st = p;
+	long i = set * st->E + way;
+
+	(void)next;
+	st->key[i] = 1;
+	st->stamp[i] = ++st->clock;
+}
+
+static int lfu_victim(void *p, long set)
+{
+	KeyState *st = p;
+	long *key = st->key + set * st->E;
+	long *stamp = st->stamp + set * st->E;
+	int i, best = 0;
+
+	for(i=1; i!=st->E; ++i)
+		if(key[i] < key[best] ||
+		   (key[i] == key[best] && stamp[i] < stamp[best]))
+			best = i;
+	return best;
+}
+
+static void opt_touch(void *p, long set, int way, long next)
+{
+	KeyState *st = p;
+
+	st->key[set * st->E + way] = next;
+}
+
+static int opt_victim(void *p, long set)
+{
+	KeyState *st = p;
+	long *key = st->key + set * st->E;
+	int i, best = 0;
+
+	for(i=1; i!=st->E; ++i)
+		if(key[i] > key[best])
+			best = i;
+	return best;
+}
+
+static const Policy lru = {
+	"lru", "least recently used",
+	lru_create, list_destroy, list_hit, list_fill, list_victim, list_drop
+};
+static const Policy fifo = {
+	"fifo", "first in, first out",
+	fifo_create, list_destroy, list_hit, list_fill, list_victim, list_drop
+};
+static const Policy random_policy = {
+	"random", "uniformly random way (seeded with -r)",
+	random_create, free, nop, nop, random_victim, NULL
+};
+static const Policy plru = {
+	"plru", "tree pseudo-LRU",
+	tree_create, tree_destroy, tree_touch, tree_touch, tree_victim, NULL
+};
+static const Policy bitplru = {
+	"bitplru", "MRU-bit pseudo-LRU",
+	bit_create, bit_destroy, bit_touch, bit_touch, bit_victim, bit_drop
+};
+static const Policy srrip = {
+	"srrip", "static re-reference interval prediction",
+	srrip_create, rrip_destroy, rrip_hit, rrip_fill, rrip_victim, NULL
+};
+static const Policy brrip = {
+	"brrip", "bimodal re-reference interval prediction",
+	brrip_create, rrip_destroy, rrip_hit, rrip_fill, rrip_victim, NULL
+};
+static const Policy lfu = {
+	"lfu", "least frequently used",
+	key_create, key_destroy, lfu_hit, lfu_fill, lfu_victim, NULL
+};
+static const Policy opt = {
+	"opt", "Belady's optimal, with trace lookahead",
+	key_create, key_destroy, opt_touch, opt_touch, opt_victim, NULL
+};
+
+const Policy *const policies[] = {
+	&lru, &fifo, &random_policy, &plru, &bitplru, &srrip, &brrip, &lfu,
+	&opt, NULL
+};
+
+const Policy *find_policy(const char *name)
+{
+	int i;
+
+	for(i=0; policies[i]; ++i)
+		if(strcmp(policies[i]->name, name) == 0)
+			return policies[i];
+	return NULL;
+}
+
+/*
+ * next_uses - Walk the trace backwards with an open-addressed table
+ * from block to the index of its latest (that is, next) access.
+ */
+long *next_uses(const unsigned long *blocks, long n)
+{
+	long *next = malloc((n ? n : 1) * sizeof(long));
+	unsigned long *keys;
+	long *at;
+	unsigned long size = 16, mask, h;
+	int bits = 4;
+	long i;
+
+	if(!next)
+		return NULL;
+	while(size < 2 * (unsigned long)n) {
+		size <<= 1;
+		bits++;
+	}
+	mask = size - 1;
+	keys = malloc(size * sizeof(unsigned long));
+	at = malloc(size * sizeof(long));
+	if(!keys || !at) {
+		free(keys);
+		free(at);
+		free(next);
+		return NULL;
+	}
+	for(h=0; h!=size; ++h)
+		at[h] = NEVER;
+
+	for(i=n-1; i>=0; --i) {
+		h = (blocks[i] * 0x9E3779B97F4A7C15UL) >> (64 - bits);
+		while(at[h] != NEVER && keys[h] != blocks[i])
+			h = (h + 1) & mask;
+		next[i] = at[h];
+		keys[h] = blocks[i];
+		at[h] = i;
+	}
+	free(keys);
+	free(at);
+	return next;
+}
@@ -0,0 +1,53 @@
+/*
+ * policy.h - Replacement policies for the cache simulator
+ *
+ * A policy sees the cache only as S sets of E ways. The cache tells it
+ * about every hit, fill and invalidation and asks it for a victim when
+ * a full set misses; what it keeps to decide is its own business. To
+ * add a policy, write its functions and add a Policy to the table in
+ * policy.c.
+ */
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <limits.h>
+
+/* Next-use time of a block that is never used again */
+#define NEVER LONG_MAX
+
+typedef struct Policy {
+	const char *name;
+	const char *desc;
+
+	/* State for S sets of E ways, or NULL if out of memory */
+	void *(*create)(long S, int E, unsigned long seed);
+	void (*destroy)(void *st);
+
+	/*
+	 * A hit on, or a fill of, a way of a set. next is the time of the
+	 * block's next access (NEVER if none); only OPT looks at it.
+	 */
+	void (*hit)(void *st, long set, int way, long next);
+	void (*fill)(void *st, long set, int way, long next);
+
+	/* The way of a full set to evict */
+	int (*victim)(void *st, long set);
+
+	/* A valid way was invalidated; NULL if the policy doesn't care */
+	void (*drop)(void *st, long set, int way);
+} Policy;
+
+/* find_policy - The policy called name, or NULL */
+const Policy *find_policy(const char *name);
+
+/* Every policy, NULL terminated, in the order "-p all" runs them */
+extern const Policy *const policies[];
+
+/*
+ * next_uses - For each of the n block addresses, the index of the next
+ * access to the same block, or NEVER. This is the lookahead OPT needs.
+ * Returns a malloc'd array, or NULL if out of memory.
+ */
+long *next_uses(const unsigned long *blocks, long n);
+
+#endif /* POLICY_H */
@@ -0,0 +1,248 @@
+/*
+ * prefetch.c - Hardware prefetchers in front of the first cache level
+ *
+ * The prefetchers see only the addresses of demand accesses, as the
+ * trace has no program counters.
+ *
+ * NEXT_LINE: a miss, or the first hit on a prefetched block, fetches
+ *     the degree blocks starting distance blocks on.
+ * STRIDE: a table of recent 4KB pages keeps the last block touched in
+ *     each and the stride between the last two. When the same stride
+ *     comes up twice running, the next degree strides starting distance
+ *     strides ahead are fetched.
+ * STREAM: stream buffers, after Jouppi. A miss outside every stream
+ *     starts one, replacing the least recently used, running up or down
+ *     as the miss before it suggests. Each access to the block a stream
+ *     expects next moves it on, keeping degree blocks in flight up to
+ *     distance blocks ahead. The blocks go into the cache itself rather
+ *     than into buffers beside it, so that they are counted like the
+ *     other prefetchers'.
+ *
+ * Prefetched blocks not yet used are kept in an open-addressed set, so
+ * that each can be counted as useful when it is first used or useless
+ * if it leaves the cache before that. They are all in the cache, so the
+ * set is sized for a full cache once and for all.
+ */
+#include "prefetch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_BITS   12
+#define STRIDE_BITS 6
+#define STRIDE_ROWS (1 << STRIDE_BITS)
+#define STREAMS     8
+#define EMPTY       (~0UL)
+
+typedef struct {
+	unsigned long page;
+	unsigned long last;	/* block */
+	long stride;		/* between the last two blocks */
+} StrideRow;
+
+typedef struct {
+	unsigned long next;	/* the block it expects next */
+	unsigned long ahead;	/* the furthest block it has fetched */
+	int dir;		/* +1 or -1; 0 if unused */
+	long used;		/* when it last moved on, for LRU */
+} Stream;
+
+struct Prefetcher {
+	PrefetchConfig cfg;
+	int b;
+	StrideRow rows[STRIDE_ROWS];
+	Stream streams[STREAMS];
+	unsigned long last_miss;
+	long now;
+	unsigned long *pending;	/* blocks, EMPTY where free */
+	long npending;
+	int pbits;
+};
+
+static inline unsigned long hash(unsigned long key, int bits)
+{
+	return (key * 0x9E3779B97F4A7C15UL) >> (64 - bits);
+}
+
+Prefetcher *make_prefetcher(const PrefetchConfig *cfg, int b, long lines)
+{
+	Prefetcher *pf = calloc(1, sizeof(Prefetcher));
+	int i;
+
+	if(!pf)
+		return NULL;
+	pf->cfg = *cfg;
+	pf->b = b;
+	pf->last_miss = EMPTY;
+	for(i=0; i!=STRIDE_ROWS; ++i)
+		pf->rows[i].page = EMPTY;
+	for(pf->pbits = 4; 1L << pf->pbits < 2 * lines; pf->pbits++)
+		;
+	if(!(pf->pending = malloc(sizeof(unsigned long) << pf->pbits))) {
+		free(pf);
+		return NULL;
+	}
+	memset(pf->pending, 0xff, sizeof(unsigned long) << pf->pbits);
+	return pf;
+}
+
+void free_prefetcher(Prefetcher *pf)
+{
+	free(pf->pending);
+	free(pf);
+}
+
+/* ahead - Fill out with the degree blocks from block on, step apart */
+static int ahead(const Prefetcher *pf, unsigned long block, long step,
+		 unsigned long *out)
+{
+	int i;
+
+	for(i=0; i!=pf->cfg.degree; ++i)
+		out[i] = (block + step * i) << pf->b;
+	return pf->cfg.degree;
+}
+
+static int train_stride(Prefetcher *pf, unsigned long block, unsigned long *out)
+{
+	unsigned long page = block >> (PAGE_BITS > pf->b ? PAGE_BITS - pf->b : 0);
+	StrideRow *row = &pf->rows[hash(page, STRIDE_BITS)];
+	long stride;
+
+	if(row->page != page) {
+		row->page = page;
+		row->last = block;
+		row->stride = 0;
+		return 0;
+	}
+	stride = (long)(block - row->last);
+	if(stride == 0)
+		return 0;
+	row->last = block;
+	if(stride != row->stride) {
+		row->stride = stride;
+		return 0;
+	}
+	return ahead(pf, block + stride * pf->cfg.distance, stride, out);
+}
+
+static int train_stream(Prefetcher *pf, unsigned long block, int miss,
+			unsigned long *out)
+{
+	Stream *s = NULL;
+	unsigned long limit;
+	int i, n = 0;
+
+	for(i=0; i!=STREAMS; ++i)
+		if(pf->streams[i].dir && pf->streams[i].next == block)
+			s = &pf->streams[i];
+	if(!s) {
+		if(!miss)
+			return 0;
+		/* start a stream in the least recently used buffer */
+		s = &pf->streams[0];
+		for(i=1; i!=STREAMS; ++i)
+			if(pf->streams[i].used < s->used)
+				s = &pf->streams[i];
+		s->dir = pf->last_miss == block + 1 ? -1 : 1;
+		s->ahead = block;
+	}
+	if(miss)
+		pf->last_miss = block;
+	s->next = block + s->dir;
+	s->used = ++pf->now;
+	limit = block + s->dir * pf->cfg.distance;
+	while(n != pf->cfg.degree && s->ahead != limit) {
+		s->ahead += s->dir;
+		out[n++] = s->ahead << pf->b;
+	}
+	return n;
+}
+
+int prefetch_train(Prefetcher *pf, unsigned long addr, int trigger,
+		   unsigned long *out)
+{
+	unsigned long block = addr >> pf->b;
+
+	switch(pf->cfg.kind) {
+		case NEXT_LINE:
+			if(!trigger)
+				return 0;
+			return ahead(pf, block + pf->cfg.distance, 1, out);
+		case STRIDE:
+			return train_stride(pf, block, out);
+		default:
+			return train_stream(pf, block, trigger, out);
+	}
+}
+
+void prefetch_mark(Prefetcher *pf, unsigned long addr)
+{
+	unsigned long block = addr >> pf->b;
+	unsigned long mask = (1UL << pf->pbits) - 1;
+	unsigned long h;
+
+	for(h = hash(block, pf->pbits); pf->pending[h] != EMPTY; h = (h + 1) & mask)
+		if(pf->pending[h] == block)
+			return;
+	pf->pending[h] = block;
+	pf->npending++;
+}
+
+int prefetch_clear(Prefetcher *pf, unsigned long addr)
+{
+	unsigned long block = addr >> pf->b;
+	unsigned long mask = (1UL << pf->pbits) - 1;
+	unsigned long h, j, home;
+
+	for(h = hash(block, pf->pbits); pf->pending[h] != block; h = (h + 1) & mask)
+		if(pf->pending[h] == EMPTY)
+			return 0;
+	/* close the gap, moving back whatever probed past it */
+	for(j = (h + 1) & mask; pf->pending[j] != EMPTY; j = (j + 1) & mask) {
+		home = hash(pf->pending[j], pf->pbits);
+		if(((j - home) & mask) >= ((j - h) & mask)) {
+			pf->pending[h] = pf->pending[j];
+			h = j;
+		}
+	}
+	pf->pending[h] = EMPTY;
+	pf->npending--;
+	return 1;
+}
+
+long prefetch_pending(const Prefetcher *pf)
+{
+	return pf->npending;
+}
+
+int parse_prefetch(const char *arg, PrefetchConfig *cfg)
+{
+	char kind[16];
+	int n;
+
+	cfg->degree = 1;
+	cfg->distance = 1;
+	n = sscanf(arg, "%15[^:]:%d:%d", kind, &cfg->degree, &cfg->distance);
+	if(n < 1 || cfg->degree < 1 || cfg->degree > MAX_DEGREE ||
+	   cfg->distance < 1)
+		return 0;
+	if(strcmp(kind, "next") == 0)
+		cfg->kind = NEXT_LINE;
+	else if(strcmp(kind, "stride") == 0)
+		cfg->kind = STRIDE;
+	else if(strcmp(kind, "stream") == 0)
+		cfg->kind = STREAM;
+	else
+		return 0;
+	/* a stream keeps degree blocks within distance */
+	if(cfg->kind == STREAM && cfg->distance < cfg->degree)
+		cfg->distance = cfg->degree;
+	return 1;
+}
+
+const char *prefetch_name(int kind)
+{
+	return kind == NEXT_LINE ? "next" : kind == STRIDE ? "stride" : "stream";
+}
@@ -0,0 +1,56 @@
+/*
+ * prefetch.h - Hardware prefetchers in front of the first cache level
+ */
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#define MAX_DEGREE 16
+
+/* Kinds of prefetcher */
+enum { NEXT_LINE, STRIDE, STREAM };
+
+typedef struct {
+	int kind;
+	int degree;		/* blocks fetched each time it fires */
+	int distance;		/* how many blocks (or strides) ahead */
+} PrefetchConfig;
+
+typedef struct Prefetcher Prefetcher;
+
+/*
+ * make_prefetcher - A prefetcher for a cache of the given number of
+ * lines of 2^b bytes. Returns NULL if out of memory.
+ */
+Prefetcher *make_prefetcher(const PrefetchConfig *cfg, int b, long lines);
+void free_prefetcher(Prefetcher *pf);
+
+/*
+ * prefetch_train - Show it a demand access to the first level, which
+ * missed, or hit a block it fetched (trigger), or just hit. Returns how
+ * many block addresses it wants fetched, into out.
+ */
+int prefetch_train(Prefetcher *pf, unsigned long addr, int trigger,
+		   unsigned long *out);
+
+/*
+ * Blocks brought in by prefetching and not used yet, which the cache
+ * must tell the prefetcher about.
+ * prefetch_mark - The block at addr was just fetched
+ * prefetch_clear - The block at addr was used or left the cache;
+ *     returns whether it had been fetched and not used
+ * prefetch_pending - How many are still waiting
+ */
+void prefetch_mark(Prefetcher *pf, unsigned long addr);
+int prefetch_clear(Prefetcher *pf, unsigned long addr);
+long prefetch_pending(const Prefetcher *pf);
+
+/*
+ * parse_prefetch - Read "kind[:degree[:distance]]", kind next, stride
+ * or stream, into cfg. Returns 0 if malformed.
+ */
+int parse_prefetch(const char *arg, PrefetchConfig *cfg);
+
+/* prefetch_name - The name of a kind */
+const char *prefetch_name(int kind);
+
+#endif /* PREFETCH_H */
@@ -0,0 +1,278 @@
+/*
+ * sample.c - Simulating a sample of the sets and scaling up
+ *
+ * Sets don't interact, so simulating some of them exactly and scaling
+ * their counts up estimates the whole cache, in a fraction of the time
+ * (after Kessler, Hill and Wood). With a hierarchy the unit is a group
+ * of sets: accesses whose address bits that every level indexes by are
+ * the same, so each set of each level is in one group and sees all its
+ * accesses.
+ *
+ * A trace's accesses can crowd into a few groups (its stack, say),
+ * which a plain random sample is likely to miss altogether; then every
+ * picked group looks alike and the estimate comes out tight around the
+ * wrong answer. So the trace is read twice. The first pass only decodes
+ * addresses and counts the accesses to every group; the groups are then
+ * put in strata by the power of two of their count, and one in rate of
+ * each stratum is picked, but at least two (or all, if it has fewer),
+ * uniformly at random or, by hash, the same ones for a trace whatever
+ * the seed. Groups with no accesses need no simulating at all. The
+ * second pass simulates the picked groups.
+ *
+ * A count is estimated per stratum, as the mean over its picked groups
+ * times its number of groups, and summed; the variances between the
+ * groups of each stratum, corrected for sampling without replacement,
+ * give a 95% interval, taken from Student's t rather than the normal
+ * since a stratum may have only two picked. Misses and evictions are
+ * estimated that way.
+ * Accesses are known exactly, so hits are the accesses less the
+ * estimated misses, with the misses' interval, and the miss rate is the
+ * estimated misses over the exact accesses.
+ */
+#include "sample.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+#define MAX_KEY_BITS 24
+#define STRATA 65		/* by the bit length of a group's accesses */
+
+struct Sampler {
+	int shift;
+	int rate, hashed;
+	unsigned long seed;
+	long groups, picked;
+	int strata;		/* that have any groups */
+	unsigned char *keep;	/* per group */
+	unsigned char *stratum;	/* per group */
+	long *seen;		/* per group: accesses, picked or not */
+	long (*counts)[ESTIMATES];	/* per group, if picked */
+};
+
+/* A group to be picked or not, in the order of picking */
+typedef struct {
+	int stratum;
+	unsigned long rank;
+	long g;
+} Candidate;
+
+/* xorshift64*, as in policy.c */
+static unsigned long next_random(unsigned long *x)
+{
+	*x ^= *x >> 12;
+	*x ^= *x << 25;
+	*x ^= *x >> 27;
+	return *x * 0x2545F4914F6CDD1DUL;
+}
+
+Sampler *make_sampler(const Hierarchy *h, int rate, int hashed,
+		      unsigned long seed)
+{
+	Sampler *sp;
+	int bits;
+
+	errno = ENOMEM;
+	if(!(sp = calloc(1, sizeof(Sampler))))
+		return NULL;
+	sp->rate = rate;
+	sp->hashed = hashed;
+	sp->seed = seed ? seed : 1;
+	bits = set_key_bits(h, &sp->shift);
+	if(bits > MAX_KEY_BITS)
+		bits = MAX_KEY_BITS;
+	sp->groups = 1L << bits;
+	sp->keep = calloc(sp->groups, 1);
+	sp->stratum = calloc(sp->groups, 1);
+	sp->seen = calloc(sp->groups, sizeof(long));
+	sp->counts = calloc(sp->groups, sizeof(*sp->counts));
+	if(!sp->keep || !sp->stratum || !sp->seen || !sp->counts)
+		goto fail;
+	if(sp->groups / rate < 2) {
+		errno = 0;
+		goto fail;
+	}
+	return sp;
+fail:
+	free_sampler(sp);
+	return NULL;
+}
+
+void free_sampler(Sampler *sp)
+{
+	free(sp->keep);
+	free(sp->stratum);
+	free(sp->seen);
+	free(sp->counts);
+	free(sp);
+}
+
+static int by_rank(const void *a, const void *b)
+{
+	const Candidate *x = a, *y = b;
+
+	if(x->stratum != y->stratum)
+		return x->stratum - y->stratum;
+	return x->rank < y->rank ? -1 : x->rank > y->rank;
+}
+
+int sample_plan(Sampler *sp, Trace *t)
+{
+	Candidate *c;
+	unsigned long x = sp->seed;
+	long g, i, j, n, want;
+	Ref r;
+	int k;
+
+	/* nothing is kept, so this only counts */
+	sample_trace(t, sp->shift, sp->groups - 1, sp->keep, sp->seen);
+	while(next_ref(t, &r))
+		;
+	if(!(c = malloc(sp->groups * sizeof(Candidate))))
+		return 0;
+	for(g=0; g!=sp->groups; ++g) {
+		for(k = 0; k != 64 && sp->seen[g] >> k; ++k)
+			;
+		sp->stratum[g] = k;
+		c[g].stratum = k;
+		c[g].rank = sp->hashed ? g * 0x9E3779B97F4A7C15UL : next_random(&x);
+		c[g].g = g;
+	}
+	qsort(c, sp->groups, sizeof(Candidate), by_rank);
+	for(i=0; i!=sp->groups; i=j) {
+		for(j=i; j!=sp->groups && c[j].stratum == c[i].stratum; ++j)
+			;
+		sp->strata++;
+		if(c[i].stratum == 0)
+			continue;	/* never accessed */
+		n = j - i;
+		want = (n + sp->rate / 2) / sp->rate;
+		if(want < 2)
+			want = n < 2 ? n : 2;
+		for(g=0; g!=want; ++g)
+			sp->keep[c[i+g].g] = 1;
+		sp->picked += want;
+	}
+	free(c);
+	return 1;
+}
+
+void sample_filter(const Sampler *sp, Trace *t)
+{
+	sample_trace(t, sp->shift, sp->groups - 1, sp->keep, NULL);
+}
+
+void sample_count(Sampler *sp, unsigned long addr, int r)
+{
+	long *c = sp->counts[(addr >> sp->shift) & (sp->groups - 1)];
+
+	if(r & HIT)
+		c[EST_HITS]++;
+	if(r & MISS)
+		c[EST_MISSES]++;
+	if(r & EVICT)
+		c[EST_EVICTIONS]++;
+}
+
+long sample_accesses(const Sampler *sp)
+{
+	long g, n = 0;
+
+	for(g=0; g!=sp->groups; ++g)
+		n += sp->seen[g];
+	return n;
+}
+
+double sample_factor(const Sampler *sp)
+{
+	double est, bound;
+	long g, misses = 0, accesses = 0;
+
+	for(g=0; g!=sp->groups; ++g) {
+		if(!sp->keep[g])
+			continue;
+		misses += sp->counts[g][EST_MISSES];
+		accesses += sp->seen[g];
+	}
+	if(misses) {
+		sample_estimate(sp, EST_MISSES, &est, &bound);
+		return est / misses;
+	}
+	return accesses ? (double)sample_accesses(sp) / accesses : 1.0;
+}
+
+void sample_groups(const Sampler *sp, long *picked, long *groups,
+		   int *strata)
+{
+	*picked = sp->picked;
+	*groups = sp->groups;
+	*strata = sp->strata;
+}
+
+/*
+ * quantile - Student's t at 97.5% for df degrees of freedom: with only
+ * a few groups picked per stratum, their spread is itself a guess, and
+ * the normal 1.96 would make the interval too tight
+ */
+static double quantile(long df)
+{
+	static const double t[] = { 1.96, 12.71, 4.30, 3.18, 2.78 };
+
+	if(df < 5)
+		return t[df];
+	return 1.96 + 2.4 / df + 3.0 / ((double)df * df);
+}
+
+void sample_estimate(const Sampler *sp, int which, double *est,
+		     double *bound)
+{
+	double sum[STRATA] = { 0 }, sumsq[STRATA] = { 0 };
+	long n[STRATA] = { 0 }, N[STRATA] = { 0 };
+	double x, v, var = 0, vdf = 0, s2;
+	long g;
+	int k, hits = which == EST_HITS;
+
+	if(hits)
+		which = EST_MISSES;
+	for(g=0; g!=sp->groups; ++g) {
+		k = sp->stratum[g];
+		N[k]++;
+		if(!sp->keep[g])
+			continue;
+		x = sp->counts[g][which];
+		n[k]++;
+		sum[k] += x;
+		sumsq[k] += x * x;
+	}
+	*est = 0;
+	for(k=0; k!=STRATA; ++k) {
+		if(!n[k])
+			continue;	/* no accesses, so nothing to count */
+		*est += N[k] * sum[k] / n[k];
+		if(n[k] == N[k])
+			continue;	/* counted exactly */
+		s2 = (sumsq[k] - sum[k] * sum[k] / n[k]) / (n[k] - 1);
+		v = (double)N[k] * N[k] * (1 - (double)n[k] / N[k]) * s2 / n[k];
+		/*
+		 * Picked groups all alike say little: up to 3 in n of the
+		 * rest could still be one off, at 95%
+		 */
+		x = 3.0 * (N[k] - n[k]) / n[k] / 1.96;
+		v = v > x * x ? v : x * x;
+		var += v;
+		vdf += v * v / (n[k] - 1);
+	}
+	/* Satterthwaite's degrees of freedom, near the fewest picked */
+	*bound = quantile(vdf > 0 ? (long)(var * var / vdf) : 0) * sqrt(var);
+	if(hits)
+		*est = sample_accesses(sp) - *est;
+}
+
+void sample_miss_rate(const Sampler *sp, double *est, double *bound)
+{
+	long accesses = sample_accesses(sp);
+
+	sample_estimate(sp, EST_MISSES, est, bound);
+	*est = accesses ? *est / accesses : 0;
+	*bound = accesses ? *bound / accesses : 0;
+}
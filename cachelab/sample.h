@@ -0,0 +1,68 @@
+/*
+ * sample.h - Simulating a sample of the sets and scaling up
+ */
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include "hierarchy.h"
+#include "trace.h"
+
+/* Counts that are estimated */
+enum { EST_HITS, EST_MISSES, EST_EVICTIONS, ESTIMATES };
+
+typedef struct Sampler Sampler;
+
+/*
+ * make_sampler - Set up to simulate one in every rate groups of sets of
+ * h, where a group is the sets each level has for one value of the
+ * address bits every level's set index shares. Returns NULL if there
+ * are too few groups to pick two, with errno 0, or if out of memory.
+ */
+Sampler *make_sampler(const Hierarchy *h, int rate, int hashed,
+		      unsigned long seed);
+void free_sampler(Sampler *sp);
+
+/*
+ * sample_plan - Read t to its end, counting the accesses to each group,
+ * and pick the groups: at random from seed, or by a hash of the group
+ * if hashed, within strata of groups with like numbers of accesses.
+ * Returns 0 if out of memory.
+ */
+int sample_plan(Sampler *sp, Trace *t);
+
+/*
+ * sample_filter - Have t, opened again after sample_plan, hand out only
+ * the accesses to the picked groups
+ */
+void sample_filter(const Sampler *sp, Trace *t);
+
+/* sample_count - Count an access to addr, which had result r at L1 */
+void sample_count(Sampler *sp, unsigned long addr, int r);
+
+/*
+ * sample_factor - What the counts of the picked groups are scaled by,
+ * on the whole: the estimated misses over the misses simulated
+ */
+double sample_factor(const Sampler *sp);
+
+/* sample_accesses - Accesses to every group, picked or not */
+long sample_accesses(const Sampler *sp);
+
+/*
+ * sample_groups - Into *picked, *groups and *strata, how many groups
+ * were picked out of how many, in how many strata
+ */
+void sample_groups(const Sampler *sp, long *picked, long *groups,
+		   int *strata);
+
+/*
+ * sample_estimate - The estimate of one count for all the sets, and the
+ * half width of its 95% confidence interval; hits are the accesses less
+ * the misses
+ * sample_miss_rate - The same for the L1 miss rate
+ */
+void sample_estimate(const Sampler *sp, int which, double *est,
+		     double *bound);
+void sample_miss_rate(const Sampler *sp, double *est, double *bound);
+
+#endif /* SAMPLE_H */
@@ -0,0 +1,177 @@
+/*
+ * shard.c - Replaying a trace on several threads, split by cache set
+ *
+ * Sets never interact, so the caller's thread reads the trace and deals
+ * each access out to a worker that owns its sets, which simulates them
+ * on its own copy of every hierarchy; the counts are added up at the
+ * end. Consecutive sets go to different workers, which keeps the load
+ * even when a program walks through memory.
+ *
+ * Accesses travel in batches through a ring per worker with a single
+ * writer and a single reader, so neither side takes a lock: the reader
+ * publishes a filled batch by moving head on, the worker frees it by
+ * moving tail on. Whoever finds the ring full or empty yields the CPU
+ * and then sleeps a little while it waits.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "shard.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define BATCH 4096		/* accesses per batch */
+#define RING  8			/* batches per worker */
+
+typedef struct {
+	unsigned long addr;
+	long next;
+	int write, size;
+} Access;
+
+typedef struct {
+	Access acc[BATCH];
+	int n;
+} Batch;
+
+typedef struct {
+	Batch ring[RING];
+	unsigned long head;	/* batches published, by the reader */
+	unsigned long tail;	/* batches done, by the worker */
+	int done;		/* no more batches will come */
+	int fill;		/* accesses in the batch at head, reader's */
+	Hierarchy **sims;
+	int nsims;
+	pthread_t thread;
+} Worker;
+
+struct Shards {
+	Worker *w;
+	Hierarchy **sims;
+	int nthreads, nsims;
+	int shift;		/* the key is the bits from here up */
+	unsigned long mask;
+};
+
+int max_shards(const Hierarchy *h)
+{
+	int shift, bits = set_key_bits(h, &shift);
+
+	return bits >= 6 ? MAX_THREADS : 1 << bits;
+}
+
+/* wait_turn - Let the other side run; *tries counts the waits in a row */
+static void wait_turn(int *tries)
+{
+	struct timespec ts = { 0, 50000 };
+
+	if(++*tries < 64)
+		sched_yield();
+	else
+		nanosleep(&ts, NULL);
+}
+
+static void *work(void *arg)
+{
+	Worker *w = arg;
+	const Batch *bt;
+	const Access *a;
+	unsigned long tail = 0;
+	int i, j, tries = 0;
+
+	for(;;) {
+		if(tail == __atomic_load_n(&w->head, __ATOMIC_ACQUIRE)) {
+			/* head is final once done is set */
+			if(__atomic_load_n(&w->done, __ATOMIC_ACQUIRE) &&
+			   tail == __atomic_load_n(&w->head, __ATOMIC_ACQUIRE))
+				return NULL;
+			wait_turn(&tries);
+			continue;
+		}
+		tries = 0;
+		bt = &w->ring[tail % RING];
+		for(i=0; i!=bt->n; ++i) {
+			a = &bt->acc[i];
+			for(j=0; j!=w->nsims; ++j)
+				access_hierarchy(w->sims[j], a->addr, a->next,
+						 a->write, a->size);
+		}
+		__atomic_store_n(&w->tail, ++tail, __ATOMIC_RELEASE);
+	}
+}
+
+Shards *start_shards(Hierarchy **sims, int nsims, int nthreads)
+{
+	Shards *sh = calloc(1, sizeof(Shards));
+	int i;
+
+	if(!sh)
+		return NULL;
+	if(!(sh->w = calloc(nthreads, sizeof(Worker)))) {
+		free(sh);
+		return NULL;
+	}
+	sh->sims = sims;
+	sh->nsims = nsims;
+	sh->nthreads = nthreads;
+	sh->mask = (1UL << set_key_bits(sims[0], &sh->shift)) - 1;
+	for(i=0; i!=nthreads; ++i) {
+		sh->w[i].sims = sims + i * nsims;
+		sh->w[i].nsims = nsims;
+		if(pthread_create(&sh->w[i].thread, NULL, work, &sh->w[i])) {
+			sh->nthreads = i;
+			finish_shards(sh);
+			return NULL;
+		}
+	}
+	return sh;
+}
+
+/* publish - Hand the batch being filled to the worker */
+static void publish(Worker *w)
+{
+	w->ring[w->head % RING].n = w->fill;
+	w->fill = 0;
+	__atomic_store_n(&w->head, w->head + 1, __ATOMIC_RELEASE);
+}
+
+void shard_access(Shards *sh, unsigned long addr, long next, int write,
+		  int size)
+{
+	Worker *w = &sh->w[((addr >> sh->shift) & sh->mask) % sh->nthreads];
+	Access *a;
+	int tries = 0;
+
+	/* the slot at head is ours once the worker is done with it */
+	if(w->fill == 0)
+		while(w->head - __atomic_load_n(&w->tail, __ATOMIC_ACQUIRE) == RING)
+			wait_turn(&tries);
+	a = &w->ring[w->head % RING].acc[w->fill++];
+	a->addr = addr;
+	a->next = next;
+	a->write = write;
+	a->size = size;
+	if(w->fill == BATCH)
+		publish(w);
+}
+
+void finish_shards(Shards *sh)
+{
+	int i, j;
+
+	for(i=0; i!=sh->nthreads; ++i) {
+		if(sh->w[i].fill)
+			publish(&sh->w[i]);
+		__atomic_store_n(&sh->w[i].done, 1, __ATOMIC_RELEASE);
+	}
+	for(i=0; i!=sh->nthreads; ++i) {
+		pthread_join(sh->w[i].thread, NULL);
+		if(i)
+			for(j=0; j!=sh->nsims; ++j)
+				merge_hierarchy(sh->sims[j], sh->w[i].sims[j]);
+	}
+	free(sh->w);
+	free(sh);
+}
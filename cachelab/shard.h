@@ -0,0 +1,39 @@
+/*
+ * shard.h - Replaying a trace on several threads, split by cache set
+ */
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "hierarchy.h"
+
+#define MAX_THREADS 64
+
+typedef struct Shards Shards;
+
+/*
+ * max_shards - How many ways the sets of h can be split, at most. An
+ * access goes to a worker by address bits that are part of the set
+ * index at every level, so each set of each level belongs to one
+ * worker and sees its accesses in trace order.
+ */
+int max_shards(const Hierarchy *h);
+
+/*
+ * start_shards - Start nthreads workers. Worker w replays its share of
+ * the accesses on sims[w*nsims .. w*nsims+nsims-1], each worker's
+ * hierarchies the same as the first's, and nthreads at most
+ * max_shards. Returns NULL on failure.
+ */
+Shards *start_shards(Hierarchy **sims, int nsims, int nthreads);
+
+/* shard_access - Queue an access, as for access_hierarchy */
+void shard_access(Shards *sh, unsigned long addr, long next, int write,
+		  int size);
+
+/*
+ * finish_shards - Wait for the workers to drain their queues and add
+ * the counts of every worker's hierarchies into the first's
+ */
+void finish_shards(Shards *sh);
+
+#endif /* SHARD_H */
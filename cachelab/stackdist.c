@@ -0,0 +1,241 @@
+/*
+ * stackdist.c - LRU miss counts for every cache size in one pass
+ *
+ * LRU has the inclusion property: a set of E ways holds the E blocks of
+ * the set used most recently, so an access hits exactly when fewer than
+ * E other blocks of its set were used since the block's last access
+ * (Mattson et al., 1970). Counting those distances once gives the
+ * misses of every associativity for a given block size and number of
+ * sets; one fully associative "set" gives them for every capacity.
+ *
+ * The distance is counted as in Bennett and Kruskal: each set keeps a
+ * Fenwick tree over its access times with a 1 at the last access of
+ * every block, so the distance of an access is the number of 1s after
+ * the block's previous access, found in O(log n). When a set runs out
+ * of times its live blocks are renumbered from 0.
+ */
+#include "stackdist.h"
+#include "blocktab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_TIMES 16
+
+/* The recency stack of one set */
+typedef struct {
+	int *tree;		/* Fenwick tree over times 1..cap */
+	int *who;		/* block id last accessed at each time, or -1 */
+	int cap, now, live;
+} SetStack;
+
+/* Distances for one number of sets */
+typedef struct {
+	int s;
+	SetStack *sets;
+	int *last;		/* per block id: time of its last access */
+	long *hist;		/* hist[d]: accesses at distance d */
+	long nhist;
+	long cold;		/* first accesses to a block */
+	long ways;		/* largest distance seen, plus one */
+	long dist;		/* of the last access, or -1 if cold */
+} Geometry;
+
+struct StackDist {
+	int b, n;
+	Geometry g[MAX_GEOMETRIES];
+	BlockTab tab;		/* block number -> id */
+	long accesses;
+};
+
+/* resize - Grow each geometry's last access times along with the table */
+static int resize(void *arg, long max)
+{
+	StackDist *sd = arg;
+	int k;
+
+	for(k=0; k!=sd->n; ++k) {
+		int *last = realloc(sd->g[k].last, max * sizeof(int));
+		if(!last)
+			return 0;
+		sd->g[k].last = last;
+	}
+	return 1;
+}
+
+StackDist *make_stackdist(int b, const int *s, int n)
+{
+	StackDist *sd = calloc(1, sizeof(StackDist));
+	int k;
+
+	if(!sd)
+		return NULL;
+	sd->b = b;
+	sd->n = n;
+	if(!init_blocktab(&sd->tab, resize, sd)) {
+		free(sd);
+		return NULL;
+	}
+	for(k=0; k!=n; ++k) {
+		sd->g[k].s = s[k];
+		sd->g[k].sets = calloc(1UL << s[k], sizeof(SetStack));
+		if(!sd->g[k].sets) {
+			free_stackdist(sd);
+			return NULL;
+		}
+	}
+	return sd;
+}
+
+void free_stackdist(StackDist *sd)
+{
+	long i;
+	int k;
+
+	for(k=0; k!=sd->n; ++k) {
+		Geometry *g = &sd->g[k];
+		if(g->sets) {
+			for(i=0; i!=1L << g->s; ++i) {
+				free(g->sets[i].tree);
+				free(g->sets[i].who);
+			}
+		}
+		free(g->sets);
+		free(g->last);
+		free(g->hist);
+	}
+	free_blocktab(&sd->tab);
+	free(sd);
+}
+
+long stackdist_accesses(const StackDist *sd)
+{
+	return sd->accesses;
+}
+
+long stackdist_misses(const StackDist *sd, int k, long E)
+{
+	const Geometry *g = &sd->g[k];
+	long misses = g->cold;
+	long d;
+
+	for(d = E; d < g->nhist; ++d)
+		misses += g->hist[d];
+	return misses;
+}
+
+long stackdist_ways(const StackDist *sd, int k)
+{
+	return sd->g[k].ways;
+}
+
+long stackdist_distance(const StackDist *sd, int k)
+{
+	return sd->g[k].dist;
+}
+
+static inline void tree_add(SetStack *ss, int t, int v)
+{
+	for(t++; t <= ss->cap; t += t & -t)
+		ss->tree[t] += v;
+}
+
+/* tree_sum - The number of live times up to and including t */
+static inline int tree_sum(const SetStack *ss, int t)
+{
+	int sum = 0;
+
+	for(t++; t > 0; t -= t & -t)
+		sum += ss->tree[t];
+	return sum;
+}
+
+/*
+ * renumber - Give the live blocks of a full set times 0..live-1, in
+ * order, growing the set so that at least half its times are free.
+ */
+static int renumber(SetStack *ss, int *last)
+{
+	int cap = ss->cap;
+	int *tree, *who;
+	int t, j = 0;
+
+	if(2 * (ss->live + 1) > cap)
+		cap = 2 * (ss->live + 1) > MIN_TIMES ? 2 * (ss->live + 1) : MIN_TIMES;
+	tree = calloc(cap + 1, sizeof(int));
+	who = malloc(cap * sizeof(int));
+	if(!tree || !who) {
+		free(tree);
+		free(who);
+		return 0;
+	}
+	for(t=0; t!=ss->now; ++t) {
+		if(ss->who[t] < 0)
+			continue;
+		who[j] = ss->who[t];
+		last[who[j]] = j;
+		tree[++j] = 1;
+	}
+	/* build the Fenwick tree in place, in linear time */
+	for(t=1; t<=cap; ++t)
+		if(t + (t & -t) <= cap)
+			tree[t + (t & -t)] += tree[t];
+	free(ss->tree);
+	free(ss->who);
+	ss->tree = tree;
+	ss->who = who;
+	ss->cap = cap;
+	ss->now = j;
+	return 1;
+}
+
+int stackdist_access(StackDist *sd, unsigned long addr)
+{
+	unsigned long block = addr >> sd->b;
+	int isnew, id, k, t;
+	long d;
+
+	if((d = block_index(&sd->tab, block, &isnew)) < 0)
+		return 0;
+	id = (int)d;
+	sd->accesses++;
+
+	for(k=0; k!=sd->n; ++k) {
+		Geometry *g = &sd->g[k];
+		SetStack *ss = &g->sets[block & ((1UL << g->s) - 1)];
+
+		g->dist = -1;
+		if(isnew) {
+			g->cold++;
+		} else {
+			t = g->last[id];
+			d = ss->live - tree_sum(ss, t);
+			if(d >= g->nhist) {
+				long n = g->nhist ? 2 * g->nhist : 64;
+				long *hist;
+				while(n <= d)
+					n *= 2;
+				if(!(hist = realloc(g->hist, n * sizeof(long))))
+					return 0;
+				memset(hist + g->nhist, 0, (n - g->nhist) * sizeof(long));
+				g->hist = hist;
+				g->nhist = n;
+			}
+			g->hist[d]++;
+			g->dist = d;
+			if(d + 1 > g->ways)
+				g->ways = d + 1;
+			tree_add(ss, t, -1);
+			ss->who[t] = -1;
+			ss->live--;
+		}
+		if(ss->now == ss->cap && !renumber(ss, g->last))
+			return 0;
+		t = ss->now++;
+		tree_add(ss, t, 1);
+		ss->who[t] = id;
+		g->last[id] = t;
+		ss->live++;
+	}
+	return 1;
+}
@@ -0,0 +1,43 @@
+/*
+ * stackdist.h - LRU miss counts for every cache size in one pass
+ */
+#ifndef STACKDIST_H
+#define STACKDIST_H
+
+#define MAX_GEOMETRIES 16
+
+typedef struct StackDist StackDist;
+
+/*
+ * make_stackdist - Set up to measure stack distances for 2^b byte
+ * blocks, within sets of each of the n geometries 2^s[0], 2^s[1], ...
+ * sets. Returns NULL if out of memory.
+ */
+StackDist *make_stackdist(int b, const int *s, int n);
+void free_stackdist(StackDist *sd);
+
+/* stackdist_access - Record an access to addr; 0 if out of memory */
+int stackdist_access(StackDist *sd, unsigned long addr);
+
+/* stackdist_accesses - Accesses recorded so far */
+long stackdist_accesses(const StackDist *sd);
+
+/*
+ * stackdist_misses - Misses an LRU cache with geometry k's sets and E
+ * ways would have had
+ */
+long stackdist_misses(const StackDist *sd, int k, long E);
+
+/*
+ * stackdist_ways - The associativity from which geometry k only has
+ * cold misses left
+ */
+long stackdist_ways(const StackDist *sd, int k);
+
+/*
+ * stackdist_distance - The stack distance of the last access within
+ * geometry k's sets, or -1 if it was the block's first
+ */
+long stackdist_distance(const StackDist *sd, int k);
+
+#endif /* STACKDIST_H */
@@ -12,6 +12,7 @@
 #include <getopt.h>
 #include <sys/types.h>
 #include "cachelab.h"
+#include "libcsim.h"
 #include <sys/wait.h> // fir WEXITSTATUS
 #include <limits.h> // for INT_MAX
 
@@ -48,6 +49,9 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
 {
     int i,flag;
     unsigned int len, hits, misses, evictions;
+    CsimConfig cfg = { 1, { { s, E, b } } };
+    CsimStats st;
+    Csim *sim;
     unsigned long long int marker_start, marker_end, addr;
     char buf[1000], cmd[255];
     char filename[128];
@@ -134,18 +138,19 @@ void eval_perf(unsigned int s, unsigned int E, unsigned int b)
         }
         fclose(full_trace_fp);
 
-        /* Run the reference simulator */
+        /* Simulate the trace in process with libcsim */
         printf("Step 2: Evaluating performance (s=%d, E=%d, b=%d)\n", s, E, b);
-        char cmd[255];
-        sprintf(cmd, "./csim-ref -s %u -E %u -b %u -t trace.f%d > /dev/null", 
-                s, E, b, i);
-        system(cmd);
-    
-        /* Collect results from the reference simulator */
-        FILE* in_fp = fopen(".csim_results","r");
-        assert(in_fp);
-        fscanf(in_fp, "%u %u %u", &hits, &misses, &evictions);
-        fclose(in_fp);
+        sim = csim_create(&cfg);
+        assert(sim);
+        if (csim_replay(sim, filename) < 0) {
+            perror(filename);
+            exit(1);
+        }
+        csim_stats(sim, &st);
+        csim_destroy(sim);
+        hits = st.levels[0].hits;
+        misses = st.levels[0].misses;
+        evictions = st.levels[0].evictions;
         func_list[i].num_hits = hits;
         func_list[i].num_misses = misses;
         func_list[i].num_evictions = evictions;
@@ -0,0 +1,148 @@
+/*
+ * tlb.c - Translation lookaside buffers beside the data caches
+ *
+ * Each TLB is a Cache whose "blocks" are translations: the key of a
+ * page is its page number with the page size in the top bits, so a TLB
+ * holding several sizes indexes all of them by the low bits of the
+ * page number and keeps them apart by tag. Lookups go level by level,
+ * only to the TLBs holding the address's page size; at a level with
+ * several (say one for 4K pages and one for 2M) exactly one is asked.
+ * The TLBs that missed are filled on the way back, so a level never
+ * counts a hit it didn't have.
+ *
+ * A miss in every level walks the page table: four reads for a 4K
+ * page, three for 2M and two for 1G, each costing walk_latency cycles.
+ * Real walkers cache the upper levels, so this is an upper bound.
+ */
+#include "tlb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int page_bits[PAGE_SIZES] = { 12, 21, 30 };
+static const int walk_reads[PAGE_SIZES] = { 4, 3, 2 };
+static const char *const page_names[PAGE_SIZES] = { "4k", "2m", "1g" };
+
+Tlb *make_tlb(const TlbConfig *cfg, int n, const Region *regions,
+	      int nregions, int walk_latency)
+{
+	Tlb *t = calloc(1, sizeof(Tlb));
+	int i, s;
+
+	if(!t)
+		return NULL;
+	t->n = n;
+	t->nregions = nregions;
+	t->walk_latency = walk_latency;
+	memcpy(t->cfg, cfg, n * sizeof(TlbConfig));
+	memcpy(t->regions, regions, nregions * sizeof(Region));
+	for(i=0; i!=n; ++i) {
+		if(cfg[i].level > t->levels)
+			t->levels = cfg[i].level;
+		for(s = 0; cfg[i].ways << s < cfg[i].entries; ++s)
+			;
+		if(!(t->tlbs[i] = make_cache(s, cfg[i].ways, 0, find_policy("lru"), 0))) {
+			free_tlb(t);
+			return NULL;
+		}
+	}
+	return t;
+}
+
+void free_tlb(Tlb *t)
+{
+	int i;
+
+	for(i=0; i!=t->n; ++i)
+		if(t->tlbs[i])
+			free_cache(t->tlbs[i]);
+	free(t);
+}
+
+/* page_size - The size of the page addr is in */
+static int page_size(const Tlb *t, unsigned long addr)
+{
+	int i;
+
+	for(i=0; i!=t->nregions; ++i)
+		if(addr - t->regions[i].start < t->regions[i].len)
+			return t->regions[i].page;
+	return PAGE_4K;
+}
+
+int tlb_access(Tlb *t, unsigned long addr)
+{
+	int page = page_size(t, addr);
+	unsigned long key = (unsigned long)page << 62 | addr >> page_bits[page];
+	int i, level;
+
+	t->accesses++;
+	for(level = 1; level <= t->levels; ++level) {
+		for(i=0; i!=t->n; ++i)
+			if(t->cfg[i].level == level && (t->cfg[i].pages & 1 << page))
+				break;
+		if(i == t->n)
+			continue;
+		t->cycles += t->cfg[i].latency;
+		if(access_cache(t->tlbs[i], key, NEVER, 0) & HIT)
+			return level;
+	}
+	t->walks[page]++;
+	t->cycles += walk_reads[page] * t->walk_latency;
+	return 0;
+}
+
+/* parse_page - The page size called name, or -1 */
+static int parse_page(const char *name, int len)
+{
+	int i;
+
+	for(i=0; i!=PAGE_SIZES; ++i)
+		if((int)strlen(page_names[i]) == len &&
+		   strncmp(name, page_names[i], len) == 0)
+			return i;
+	return -1;
+}
+
+int parse_tlb(const char *arg, TlbConfig *cfg)
+{
+	char pages[32], *p, *q;
+	int n, page;
+
+	cfg->latency = 1;
+	n = sscanf(arg, "%d:%31[^:]:%d:%d:%d", &cfg->level, pages,
+		   &cfg->entries, &cfg->ways, &cfg->latency);
+	if(n < 4 || cfg->level < 1 || cfg->ways < 1 || cfg->latency < 0 ||
+	   cfg->entries < cfg->ways || cfg->entries % cfg->ways)
+		return 0;
+	/* the sets must be a power of two */
+	n = cfg->entries / cfg->ways;
+	if(n & (n - 1))
+		return 0;
+	cfg->pages = 0;
+	for(p = pages; ; p = q + 1) {
+		if(!(q = strchr(p, '+')))
+			q = p + strlen(p);
+		if((page = parse_page(p, q - p)) < 0)
+			return 0;
+		cfg->pages |= 1 << page;
+		if(!*q)
+			return 1;
+	}
+}
+
+int parse_region(const char *arg, Region *r)
+{
+	char page[8];
+
+	if(sscanf(arg, "%lx:%lx:%7s", &r->start, &r->len, page) != 3 ||
+	   (r->page = parse_page(page, strlen(page))) < 0)
+		return 0;
+	return 1;
+}
+
+const char *page_name(int page)
+{
+	return page_names[page];
+}
@@ -0,0 +1,72 @@
+/*
+ * tlb.h - Translation lookaside buffers beside the data caches
+ */
+#ifndef TLB_H
+#define TLB_H
+
+#include "cache.h"
+
+#define MAX_TLBS    8
+#define MAX_REGIONS 16
+
+/* Default cycles for each page table level a walk reads */
+#define WALK_LATENCY 20
+
+/* Page sizes */
+enum { PAGE_4K, PAGE_2M, PAGE_1G, PAGE_SIZES };
+
+/* One TLB: set-associative, for one or more page sizes */
+typedef struct {
+	int level;		/* 1 is looked in first */
+	int pages;		/* bit per page size it holds */
+	int entries, ways;
+	int latency;		/* cycles to look in it */
+} TlbConfig;
+
+/* Addresses from start to start+len are mapped with pages of one size */
+typedef struct {
+	unsigned long start, len;
+	int page;
+} Region;
+
+typedef struct {
+	int n, levels;
+	TlbConfig cfg[MAX_TLBS];
+	Cache *tlbs[MAX_TLBS];		/* entries keyed by page size and number */
+	int nregions;
+	Region regions[MAX_REGIONS];
+	int walk_latency;
+	long accesses;
+	long walks[PAGE_SIZES];		/* misses in every TLB, by page size */
+	double cycles;			/* looking in TLBs and walking */
+} Tlb;
+
+/*
+ * make_tlb - The n TLBs cfg, with addresses in the regions mapped by
+ * their page size and all others by 4K pages. Every page size in use
+ * needs a TLB at some level. Returns NULL if out of memory.
+ */
+Tlb *make_tlb(const TlbConfig *cfg, int n, const Region *regions,
+	      int nregions, int walk_latency);
+void free_tlb(Tlb *t);
+
+/*
+ * tlb_access - Translate addr: look in the TLBs for its page size level
+ * by level until one hits, filling the ones that missed, and walk the
+ * page table if none did. Returns the level that hit, or 0 for a walk.
+ */
+int tlb_access(Tlb *t, unsigned long addr);
+
+/*
+ * parse_tlb - Read "level:pages:entries:ways[:latency]", pages a page
+ * size (4k, 2m or 1g) or several joined by '+', into cfg. Returns 0 if
+ * malformed.
+ * parse_region - Read "start:len:page", start and len in hex
+ */
+int parse_tlb(const char *arg, TlbConfig *cfg);
+int parse_region(const char *arg, Region *r);
+
+/* page_name - "4k", "2m" or "1g" */
+const char *page_name(int page);
+
+#endif /* TLB_H */
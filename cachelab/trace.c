@@ -0,0 +1,545 @@
+/*
+ * trace.c - Fast reading of valgrind (lackey) memory traces
+ *
+ * Lackey writes one access per line: " L 7ff000398,8" for data and
+ * "I  04005c0,3" for instructions. Traces of multithreaded programs may
+ * tag data accesses with the core that made them, " L 7ff000398,8,1".
+ * Rather than fgets and sscanf each line, we map the file (or read it
+ * a megabyte at a time) and parse the text in place. The parser relies
+ * on every chunk it is given ending in a newline, so it never has to
+ * check for the end of the buffer; instruction lines are skipped with a
+ * memchr and no parsing.
+ *
+ * Traces can also be in a binary format, told apart by its magic
+ * number. After the 8 byte TRACE_MAGIC come blocks of a 4 byte payload
+ * length and a 4 byte record count (little-endian), then the records:
+ *
+ *     varint(zigzag(addr - previous addr) << 2 | op)  varint(size)
+ *
+ * with op 0, 1 and 2 for L, S and M. The previous address is 0 at the
+ * start of each block, so blocks decode on their own. A delta too big
+ * to shift is written as op 3 with no delta, then the op byte and the
+ * address in full. The upper bits of that op byte give the core of this
+ * and the following records, 0 from the start of each block, so an
+ * escape is also written whenever the core changes. Instruction lines
+ * are dropped. A typical access takes 2 or 3 bytes instead of the 15 to
+ * 20 of a text line.
+ *
+ * When only some sets are simulated, the reader drops the accesses to
+ * the others itself, as soon as it has their address, without parsing
+ * the rest of the line or record or handing them out. A first pass
+ * that keeps none of them can still count the accesses to every group
+ * of sets, which is what the sample is planned from.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOCK (1 << 20)
+#define BIN_BLOCK (64 * 1024)	/* payload bytes a writer buffers */
+#define MAX_RECORD 32		/* bytes one record can take */
+#define ESCAPE 3
+
+struct Trace {
+	int fd;
+	int binary;
+	unsigned long prev;	/* binary: last address of the block */
+	int core;		/* binary: core of the last record */
+	long left;		/* binary: records left in the block */
+	size_t off;		/* binary: next block's offset in the map */
+	char *map;		/* the whole file, if it is mapped */
+	size_t maplen;
+	char *buf;		/* the read buffer, or a mapped file's last line */
+	size_t buflen, filled;
+	int done;		/* nothing left to hand the parser */
+	const char *pos, *end;	/* complete lines still to parse */
+	long lines;
+	const unsigned char *keep;	/* by address key, or NULL for all */
+	long *seen;		/* accesses by address key, kept or not */
+	int kshift;
+	unsigned long kmask;
+};
+
+/* Value of a hex digit, or -1; all zeros until init_hexval */
+static signed char hexval[256];
+
+static void init_hexval(void)
+{
+	int i;
+
+	memset(hexval, -1, sizeof(hexval));
+	for(i=0; i!=10; ++i)
+		hexval['0' + i] = i;
+	for(i=0; i!=6; ++i)
+		hexval['a' + i] = hexval['A' + i] = 10 + i;
+}
+
+#define MAGIC_LEN 8
+
+/* read_full - Read up to n bytes, short only at the end of the input */
+static size_t read_full(int fd, char *buf, size_t n)
+{
+	size_t got = 0;
+	ssize_t r;
+
+	while(got < n) {
+		r = read(fd, buf + got, n - got);
+		if(r < 0 && errno == EINTR)
+			continue;
+		if(r <= 0)
+			break;
+		got += r;
+	}
+	return got;
+}
+
+Trace *open_trace(const char *path)
+{
+	Trace *t = calloc(1, sizeof(Trace));
+	struct stat st;
+
+	if(!t)
+		return NULL;
+	if(hexval['g'] == 0)
+		init_hexval();
+	if(strcmp(path, "-") == 0)
+		t->fd = STDIN_FILENO;
+	else if((t->fd = open(path, O_RDONLY)) < 0) {
+		free(t);
+		return NULL;
+	}
+
+	if(fstat(t->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		t->maplen = st.st_size;
+		t->map = mmap(NULL, t->maplen, PROT_READ, MAP_PRIVATE, t->fd, 0);
+		if(t->map == MAP_FAILED)
+			t->map = NULL;
+		else
+			posix_madvise(t->map, t->maplen, POSIX_MADV_SEQUENTIAL);
+	}
+	if(!t->map) {
+		t->buflen = BLOCK;
+		if(!(t->buf = malloc(t->buflen + 1))) {
+			close_trace(t);
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	if(t->map) {
+		t->binary = t->maplen >= MAGIC_LEN &&
+			memcmp(t->map, TRACE_MAGIC, MAGIC_LEN) == 0;
+		t->off = MAGIC_LEN;
+	} else {
+		/* a text trace gets the bytes we looked at back */
+		t->filled = read_full(t->fd, t->buf, MAGIC_LEN);
+		t->binary = t->filled == MAGIC_LEN &&
+			memcmp(t->buf, TRACE_MAGIC, MAGIC_LEN) == 0;
+		if(t->binary)
+			t->filled = 0;
+	}
+	return t;
+}
+
+void close_trace(Trace *t)
+{
+	if(t->map)
+		munmap(t->map, t->maplen);
+	if(t->fd != STDIN_FILENO)
+		close(t->fd);
+	free(t->buf);
+	free(t);
+}
+
+long trace_lines(const Trace *t)
+{
+	return t->lines;
+}
+
+/*
+ * last_line - A copy of the len bytes at p with a newline added, as the
+ * final chunk. Returns 0 if out of memory.
+ */
+static int last_line(Trace *t, const char *p, size_t len)
+{
+	char *line = malloc(len + 1);
+
+	if(!line)
+		return 0;
+	memcpy(line, p, len);
+	line[len] = '\n';
+	free(t->buf);
+	t->buf = line;
+	t->pos = line;
+	t->end = line + len + 1;
+	t->done = 1;
+	return 1;
+}
+
+/* refill - Give the parser the next chunk of lines; 0 at the end */
+static int refill(Trace *t)
+{
+	const char *nl;
+	size_t keep;
+	ssize_t n;
+
+	if(t->done)
+		return 0;
+
+	if(t->map) {
+		/* all the complete lines, then whatever follows the last */
+		if(t->pos == NULL) {
+			for(nl = t->map + t->maplen; nl != t->map && nl[-1] != '\n'; nl--)
+				;
+			t->pos = t->map;
+			t->end = nl;
+			if(nl != t->map)
+				return 1;
+		}
+		keep = t->map + t->maplen - t->end;
+		return keep && last_line(t, t->end, keep);
+	}
+
+	/* keep the partial line at the end of the buffer, and read on */
+	keep = t->pos ? t->buf + t->filled - t->end : t->filled;
+	memmove(t->buf, t->buf + t->filled - keep, keep);
+	t->filled = keep;
+	for(;;) {
+		if(t->filled == t->buflen) {
+			/* one line as long as the buffer: make room */
+			char *p = realloc(t->buf, 2 * t->buflen + 1);
+			if(!p)
+				return 0;
+			t->buf = p;
+			t->buflen *= 2;
+		}
+		n = read(t->fd, t->buf + t->filled, t->buflen - t->filled);
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			return t->filled && last_line(t, t->buf, t->filled);
+		t->filled += n;
+		for(nl = t->buf + t->filled; nl != t->buf && nl[-1] != '\n'; nl--)
+			;
+		if(nl != t->buf) {
+			t->pos = t->buf;
+			t->end = nl;
+			return 1;
+		}
+	}
+}
+
+/*
+ * kept - Count the access(es) of op to addr, and say whether they are
+ * handed out
+ */
+static inline int kept(const Trace *t, unsigned long addr, int op)
+{
+	unsigned long key;
+
+	if(!t->keep)
+		return 1;
+	key = (addr >> t->kshift) & t->kmask;
+	if(t->seen)
+		t->seen[key] += op == 'M' ? 2 : 1;
+	return t->keep[key];
+}
+
+/*
+ * parse - Parse the line at p, " <op> <hex addr>,<decimal size>", with
+ * perhaps ",<core>" after, into *r. Returns whether it was a data access
+ * that t keeps.
+ */
+static int parse(const Trace *t, const char *p, Ref *r)
+{
+	unsigned long addr = 0;
+	int size = 0, v;
+
+	while(*p == ' ' || *p == '\t')
+		p++;
+	if(*p != 'L' && *p != 'S' && *p != 'M')
+		return 0;
+	r->op = *p++;
+	while(*p == ' ' || *p == '\t')
+		p++;
+	if((v = hexval[(unsigned char)*p]) < 0)
+		return 0;
+	do {
+		addr = addr << 4 | v;
+	} while((v = hexval[(unsigned char)*++p]) >= 0);
+	if(!kept(t, addr, r->op))
+		return 0;
+	if(*p++ != ',' || *p < '0' || *p > '9')
+		return 0;
+	do {
+		size = size * 10 + (*p - '0');
+	} while(*++p >= '0' && *p <= '9');
+	r->core = 0;
+	if(*p == ',') {
+		/* the caller reports a tag out of range, if it cares */
+		while(*++p >= '0' && *p <= '9')
+			if((r->core = r->core * 10 + (*p - '0')) > MAX_CORES)
+				r->core = MAX_CORES;
+	}
+	r->addr = addr;
+	r->size = size;
+	return 1;
+}
+
+/* get32 - A little-endian 32 bit number */
+static unsigned long get32(const unsigned char *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (unsigned long)p[3] << 24;
+}
+
+static void put32(unsigned char *p, unsigned long v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/* bin_block - Make the next block of a binary trace current; 0 at the end */
+static int bin_block(Trace *t)
+{
+	unsigned char hdr[8];
+	size_t len;
+
+	if(t->map) {
+		if(t->maplen - t->off < sizeof(hdr))
+			return 0;
+		memcpy(hdr, t->map + t->off, sizeof(hdr));
+		len = get32(hdr);
+		if(t->maplen - t->off - sizeof(hdr) < len)
+			return 0;
+		t->pos = t->map + t->off + sizeof(hdr);
+		t->off += sizeof(hdr) + len;
+	} else {
+		if(read_full(t->fd, (char *)hdr, sizeof(hdr)) != sizeof(hdr))
+			return 0;
+		len = get32(hdr);
+		if(len > t->buflen) {
+			char *p = realloc(t->buf, len + 1);
+			if(!p)
+				return 0;
+			t->buf = p;
+			t->buflen = len;
+		}
+		if(read_full(t->fd, t->buf, len) != len)
+			return 0;
+		t->pos = t->buf;
+	}
+	t->end = t->pos + len;
+	t->left = get32(hdr + 4);
+	t->prev = 0;
+	t->core = 0;
+	return 1;
+}
+
+/* get_varint - Decode the varint at *pp, below end; 0 if it's cut short */
+static int get_varint(const char **pp, const char *end, unsigned long *v)
+{
+	const unsigned char *p = (const unsigned char *)*pp;
+	unsigned long x = 0;
+	int shift = 0;
+
+	do {
+		if((const char *)p == end || shift > 63)
+			return 0;
+		x |= (unsigned long)(*p & 0x7f) << shift;
+		shift += 7;
+	} while(*p++ & 0x80);
+	*pp = (const char *)p;
+	*v = x;
+	return 1;
+}
+
+static int next_bin_ref(Trace *t, Ref *r)
+{
+	unsigned long v, size;
+	int op;
+
+next:
+	while(t->left == 0)
+		if(!bin_block(t))
+			return 0;
+	if(!get_varint(&t->pos, t->end, &v))
+		return 0;
+	op = v & 3;
+	if(op == ESCAPE) {
+		if(t->pos == t->end)
+			return 0;
+		op = *t->pos & 3;
+		t->core = (unsigned char)*t->pos++ >> 2;
+		if(!get_varint(&t->pos, t->end, &t->prev))
+			return 0;
+	} else {
+		v >>= 2;
+		/* undo the zigzag: 0, 1, 2, 3 ... stand for 0, -1, 1, -2 ... */
+		t->prev += (v >> 1) ^ -(v & 1);
+	}
+	if(op != ESCAPE && !kept(t, t->prev, "LSM"[op])) {
+		/* step over the size */
+		while(t->pos != t->end && (*t->pos++ & 0x80))
+			;
+		t->left--;
+		t->lines++;
+		goto next;
+	}
+	if(op == ESCAPE || !get_varint(&t->pos, t->end, &size))
+		return 0;
+	r->op = "LSM"[op];
+	r->addr = t->prev;
+	r->size = (int)size;
+	r->core = t->core;
+	t->left--;
+	t->lines++;
+	return 1;
+}
+
+int next_ref(Trace *t, Ref *r)
+{
+	const char *p;
+	int ok;
+
+	if(t->binary)
+		return next_bin_ref(t, r);
+	for(;;) {
+		while(t->pos < t->end) {
+			p = t->pos;
+			/* instruction lines start in the first column */
+			ok = *p != 'I' && parse(t, p, r);
+			t->pos = (const char *)memchr(p, '\n', t->end - p) + 1;
+			t->lines++;
+			if(ok)
+				return 1;
+		}
+		if(!refill(t))
+			return 0;
+	}
+}
+
+void sample_trace(Trace *t, int shift, unsigned long mask,
+		  const unsigned char *keep, long *seen)
+{
+	t->kshift = shift;
+	t->kmask = mask;
+	t->keep = keep;
+	t->seen = seen;
+}
+
+struct TraceWriter {
+	FILE *fp;
+	int binary;
+	unsigned long prev;
+	int core;
+	long count;
+	unsigned char *buf, *p;
+};
+
+TraceWriter *create_trace_writer(const char *path, int binary)
+{
+	TraceWriter *w = calloc(1, sizeof(TraceWriter));
+
+	if(!w)
+		return NULL;
+	w->binary = binary;
+	if(strcmp(path, "-") == 0)
+		w->fp = stdout;
+	else if((w->fp = fopen(path, "wb")) == NULL) {
+		free(w);
+		return NULL;
+	}
+	if(binary) {
+		if(!(w->buf = malloc(BIN_BLOCK + MAX_RECORD)) ||
+		   fwrite(TRACE_MAGIC, 1, MAGIC_LEN, w->fp) != MAGIC_LEN) {
+			close_trace_writer(w);
+			return NULL;
+		}
+		w->p = w->buf;
+	}
+	return w;
+}
+
+/* flush_block - Write out the records buffered so far as one block */
+static int flush_block(TraceWriter *w)
+{
+	unsigned char hdr[8];
+	size_t len = w->p - w->buf;
+
+	if(w->count == 0)
+		return 1;
+	put32(hdr, len);
+	put32(hdr + 4, w->count);
+	if(fwrite(hdr, 1, sizeof(hdr), w->fp) != sizeof(hdr) ||
+	   fwrite(w->buf, 1, len, w->fp) != len)
+		return 0;
+	w->p = w->buf;
+	w->count = 0;
+	w->prev = 0;
+	w->core = 0;
+	return 1;
+}
+
+static unsigned char *put_varint(unsigned char *p, unsigned long v)
+{
+	while(v >= 0x80) {
+		*p++ = v | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+
+int write_ref(TraceWriter *w, const Ref *r)
+{
+	unsigned long delta, zz;
+	int op = r->op == 'L' ? 0 : r->op == 'S' ? 1 : 2;
+
+	if(!w->binary) {
+		if(r->core)
+			return fprintf(w->fp, " %c %lx,%d,%d\n", r->op, r->addr,
+				       r->size, r->core) > 0;
+		return fprintf(w->fp, " %c %lx,%d\n", r->op, r->addr, r->size) > 0;
+	}
+
+	delta = r->addr - w->prev;
+	zz = (delta << 1) ^ -(delta >> 63);
+	if(zz >> 62 || r->core != w->core) {
+		w->p = put_varint(w->p, ESCAPE);
+		*w->p++ = op | r->core << 2;
+		w->p = put_varint(w->p, r->addr);
+	} else {
+		w->p = put_varint(w->p, zz << 2 | op);
+	}
+	w->p = put_varint(w->p, r->size);
+	w->prev = r->addr;
+	w->core = r->core;
+	w->count++;
+	return w->p - w->buf < BIN_BLOCK || flush_block(w);
+}
+
+int close_trace_writer(TraceWriter *w)
+{
+	int ok = 1;
+
+	if(w->binary && w->buf)
+		ok = flush_block(w);
+	if(w->fp != stdout)
+		ok = (fclose(w->fp) == 0) && ok;
+	else
+		ok = (fflush(w->fp) == 0) && ok;
+	free(w->buf);
+	free(w);
+	return ok;
+}
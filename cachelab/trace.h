@@ -0,0 +1,62 @@
+/*
+ * trace.h - Fast reading of valgrind (lackey) memory traces
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+/* One data access line of a trace */
+typedef struct {
+	char op;		/* 'L', 'S' or 'M' */
+	int size;
+	unsigned long addr;
+	int core;		/* which core made it; 0 unless tagged,
+				   MAX_CORES if tagged with that or more */
+} Ref;
+
+/* Cores a trace can tag accesses with */
+#define MAX_CORES 64
+
+typedef struct Trace Trace;
+
+/* First bytes of a binary trace (see trace.c) */
+#define TRACE_MAGIC "CSIMTRC1"
+
+/*
+ * open_trace - Open the trace at path, or standard input if path is
+ * "-", in text or binary format. Regular files are mapped; pipes and
+ * the like are read in large blocks, so csim can follow valgrind as it
+ * runs. Returns NULL, with errno set, on failure.
+ */
+Trace *open_trace(const char *path);
+void close_trace(Trace *t);
+
+/* next_ref - Read the next data access into *r; 0 at the end of the trace */
+int next_ref(Trace *t, Ref *r);
+
+/* trace_lines - Lines read so far, instruction lines included, or records */
+long trace_lines(const Trace *t);
+
+/*
+ * sample_trace - From now on hand out only the accesses whose address
+ * bits from shift up, under mask, index a nonzero byte of keep, which
+ * must outlive the trace. The others are skipped as soon as their
+ * address is read, but still count as lines. If seen isn't NULL, every
+ * access, kept or not, is counted in it by the same index (a modify as
+ * two).
+ */
+void sample_trace(Trace *t, int shift, unsigned long mask,
+		  const unsigned char *keep, long *seen);
+
+typedef struct TraceWriter TraceWriter;
+
+/*
+ * create_trace_writer - Start a trace at path ("-" for standard output),
+ * binary or in lackey's text format. Returns NULL on failure.
+ * write_ref - Append an access; returns 0 on a write error
+ * close_trace_writer - Finish the trace; returns 0 on a write error
+ */
+TraceWriter *create_trace_writer(const char *path, int binary);
+int write_ref(TraceWriter *w, const Ref *r);
+int close_trace_writer(TraceWriter *w);
+
+#endif /* TRACE_H */
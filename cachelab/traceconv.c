@@ -0,0 +1,87 @@
+/*
+ * traceconv.c - Convert memory traces between lackey's text format and
+ * csim's binary one (see trace.c).
+ *
+ * The input may be in either format; the output is binary unless -t is
+ * given. Either file may be "-" for standard input or output, so
+ *
+ *     valgrind --tool=lackey --trace-mem=yes prog 2>&1 | traceconv - prog.bin
+ *
+ * saves a trace without ever writing it out as text.
+ *
+ * usage: traceconv [-t] <in> <out>
+ */
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+static void usage(char *argv0)
+{
+	printf("Usage: %s [-ht] <in> <out>\n", argv0);
+	printf("Options:\n");
+	printf("  -h         Print this help message.\n");
+	printf("  -t         Write lackey's text format instead of binary.\n");
+	printf("  <in>       Text or binary trace, or - for standard input.\n");
+	printf("  <out>      Converted trace, or - for standard output.\n");
+}
+
+int main(int argc, char **argv)
+{
+	Trace *in;
+	TraceWriter *out;
+	Ref r;
+	int text = 0;
+	long n = 0;
+	int c;
+
+	while((c=getopt(argc,argv,"ht"))!=-1) {
+		switch(c) {
+			case 't':
+				text = 1;
+				break;
+			case 'h':
+				usage(argv[0]);
+				exit(0);
+			default:
+				usage(argv[0]);
+				exit(1);
+		}
+	}
+	if(argc - optind != 2) {
+		usage(argv[0]);
+		exit(1);
+	}
+
+	if((in = open_trace(argv[optind])) == NULL) {
+		perror(argv[optind]);
+		exit(1);
+	}
+	if((out = create_trace_writer(argv[optind+1], !text)) == NULL) {
+		perror(argv[optind+1]);
+		exit(1);
+	}
+	while(next_ref(in, &r)) {
+		if(r.core == MAX_CORES) {
+			fprintf(stderr, "%s: core %d or more at line %ld of %s\n",
+				argv[0], MAX_CORES, trace_lines(in), argv[optind]);
+			exit(1);
+		}
+		if(!write_ref(out, &r)) {
+			perror(argv[optind+1]);
+			exit(1);
+		}
+		n++;
+	}
+	if(!close_trace_writer(out)) {
+		perror(argv[optind+1]);
+		exit(1);
+	}
+	fprintf(stderr, "%s: %ld accesses from %ld lines\n", argv[0], n,
+		trace_lines(in));
+	close_trace(in);
+	return 0;
+}
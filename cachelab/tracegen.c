@@ -4,7 +4,8 @@
  * 
  * The beginning and end of each registered transpose function's trace
  * is indicated by reading from "marker" addresses. These two marker
- * addresses are recorded in file for later use.
+ * addresses are recorded in file for later use, and where A and B are
+ * goes to .symbols, so that csim -y can name the elements that miss.
  */
 
 #include <stdlib.h>
@@ -84,6 +85,15 @@ int main(int argc, char* argv[]){
             (unsigned long long int) &MARKER_END );
     fclose(marker_fp);
 
+    /* Record the matrices as the function sees them: A is N by M */
+    FILE* sym_fp = fopen(".symbols","w");
+    assert(sym_fp);
+    fprintf(sym_fp, "A %llx %d %d %d\n",
+            (unsigned long long int) A, N, M, (int) sizeof(int));
+    fprintf(sym_fp, "B %llx %d %d %d\n",
+            (unsigned long long int) B, M, N, (int) sizeof(int));
+    fclose(sym_fp);
+
     if (-1==selectedFunc) {
         /* Invoke registered transpose functions */
         for (i=0; i < func_counter; i++) {
@@ -0,0 +1,135 @@
+/*
+ * window.c - Counts and reuse distances over windows of the trace
+ *
+ * Totals for a whole trace hide its phases: a warm-up, a steady state,
+ * a structure that outgrows the cache partway through. The trace is cut
+ * into windows of a fixed number of accesses, and each gets a CSV row
+ * of its hits, misses, evictions and miss rate, with a histogram of the
+ * reuse distances of its accesses; a last row does the same for the
+ * whole trace.
+ *
+ * The reuse distance of an access is the number of other blocks used
+ * since its block's last access: the LRU stack distance in a fully
+ * associative cache, as stackdist.c counts it, so that an access hits
+ * in any LRU cache of more blocks than that. Distances go in buckets by
+ * powers of two, 0, 1, 2-3, 4-7 and so on, plus "cold" for first uses.
+ * A bucket can be read straight off a plot against cache sizes.
+ */
+#include "window.h"
+#include "stackdist.h"
+#include "cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BUCKETS 32		/* the last takes everything from 2^30 */
+
+typedef struct {
+	long accesses, hits, misses, evictions;
+	long cold;
+	long hist[BUCKETS];
+} Counts;
+
+struct Windows {
+	StackDist *sd;
+	long len;
+	FILE *out;
+	long n;			/* windows written */
+	Counts cur, all;
+};
+
+Windows *make_windows(int b, long len, FILE *out)
+{
+	Windows *w = calloc(1, sizeof(Windows));
+	int s = 0, i;
+
+	if(!w)
+		return NULL;
+	if(!(w->sd = make_stackdist(b, &s, 1))) {
+		free(w);
+		return NULL;
+	}
+	w->len = len;
+	w->out = out;
+	fprintf(out, "window,first,accesses,hits,misses,evictions,miss_rate,cold");
+	for(i=0; i!=BUCKETS; ++i) {
+		if(i < 2)
+			fprintf(out, ",%d", i);
+		else if(i == BUCKETS - 1)
+			fprintf(out, ",%ld+", 1L << (i - 1));
+		else
+			fprintf(out, ",%ld-%ld", 1L << (i - 1), (1L << i) - 1);
+	}
+	fprintf(out, "\n");
+	return w;
+}
+
+/* bucket - The histogram bucket of distance d */
+static int bucket(long d)
+{
+	int i = 0;
+
+	while(d && i != BUCKETS - 1) {
+		d >>= 1;
+		i++;
+	}
+	return i;
+}
+
+static void add(Counts *c, long d, int r)
+{
+	c->accesses++;
+	c->hits += (r & HIT) != 0;
+	c->misses += (r & MISS) != 0;
+	c->evictions += (r & EVICT) != 0;
+	if(d < 0)
+		c->cold++;
+	else
+		c->hist[bucket(d)]++;
+}
+
+static void write_row(FILE *out, const char *name, long first, const Counts *c)
+{
+	int i;
+
+	fprintf(out, "%s,%ld,%ld,%ld,%ld,%ld,%.6f,%ld", name, first, c->accesses,
+		c->hits, c->misses, c->evictions,
+		c->accesses ? (double)c->misses / c->accesses : 0.0, c->cold);
+	for(i=0; i!=BUCKETS; ++i)
+		fprintf(out, ",%ld", c->hist[i]);
+	fprintf(out, "\n");
+}
+
+/* flush - Write out the current window and start the next */
+static void flush(Windows *w)
+{
+	char name[24];
+
+	snprintf(name, sizeof(name), "%ld", w->n);
+	write_row(w->out, name, w->n * w->len, &w->cur);
+	memset(&w->cur, 0, sizeof(w->cur));
+	w->n++;
+}
+
+int window_access(Windows *w, unsigned long addr, int r)
+{
+	long d;
+
+	if(!stackdist_access(w->sd, addr))
+		return 0;
+	d = stackdist_distance(w->sd, 0);
+	add(&w->cur, d, r);
+	add(&w->all, d, r);
+	if(w->cur.accesses == w->len)
+		flush(w);
+	return 1;
+}
+
+void finish_windows(Windows *w)
+{
+	if(w->cur.accesses)
+		flush(w);
+	write_row(w->out, "all", 0, &w->all);
+	free_stackdist(w->sd);
+	free(w);
+}
@@ -0,0 +1,30 @@
+/*
+ * window.h - Counts and reuse distances over windows of the trace
+ */
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <stdio.h>
+
+typedef struct Windows Windows;
+
+/*
+ * make_windows - Count the results of a cache with 2^b byte blocks in
+ * windows of len accesses, writing a CSV row to out as each one ends.
+ * Returns NULL if out of memory.
+ */
+Windows *make_windows(int b, long len, FILE *out);
+
+/*
+ * window_access - Count an access to addr that had result r in the
+ * cache. Returns 0 if out of memory.
+ */
+int window_access(Windows *w, unsigned long addr, int r);
+
+/*
+ * finish_windows - Write the last window, if it has begun, and a row
+ * "all" for the whole trace, then free w
+ */
+void finish_windows(Windows *w);
+
+#endif /* WINDOW_H */